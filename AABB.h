@@ -0,0 +1,13 @@
+#ifndef AABB_H
+#define AABB_H
+
+
+#include <QVector3D>
+
+struct AABB {
+    QVector3D min;
+    QVector3D max;
+};
+
+
+#endif // AABB_H
@@ -0,0 +1,353 @@
+#include "Bvh.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define BVH_USE_SSE 1
+#endif
+
+static const float BVH_INF = std::numeric_limits<float>::infinity();
+
+// 方向分量的绝对值小于此值时视为与该轴平行
+static const float BVH_PARALLEL = 1e-30f;
+
+// 一个轴上 slab 的进入与离开参数。与轴平行时起点在 slab 内则该轴不限制 t，否则整段落空，
+// 不计算 0 * inf：起点恰在 slab 平面上时结果为 NaN，SSE 与标量的 min/max 对 NaN 的处理不同
+static inline void slabAxis(float low, float high, float origin, float invDir, bool parallel, float& tNear, float& tFar) {
+    if (parallel) {
+        bool inside = low <= origin && origin <= high;
+        tNear = inside ? -BVH_INF : BVH_INF;
+        tFar = inside ? BVH_INF : -BVH_INF;
+        return;
+    }
+    float t1 = (low - origin) * invDir;
+    float t2 = (high - origin) * invDir;
+    tNear = std::min(t1, t2);
+    tFar = std::max(t1, t2);
+}
+
+#ifdef BVH_USE_SSE
+static inline void slabAxis4(__m128 low, __m128 high, float origin, float invDir, bool parallel, __m128& tNear, __m128& tFar) {
+    __m128 o = _mm_set1_ps(origin);
+    if (parallel) {
+        __m128 inside = _mm_and_ps(_mm_cmple_ps(low, o), _mm_cmple_ps(o, high));
+        __m128 inf = _mm_set1_ps(BVH_INF);
+        __m128 negInf = _mm_set1_ps(-BVH_INF);
+        tNear = _mm_or_ps(_mm_and_ps(inside, negInf), _mm_andnot_ps(inside, inf));
+        tFar = _mm_or_ps(_mm_and_ps(inside, inf), _mm_andnot_ps(inside, negInf));
+        return;
+    }
+    __m128 inv = _mm_set1_ps(invDir);
+    __m128 t1 = _mm_mul_ps(_mm_sub_ps(low, o), inv);
+    __m128 t2 = _mm_mul_ps(_mm_sub_ps(high, o), inv);
+    tNear = _mm_min_ps(t1, t2);
+    tFar = _mm_max_ps(t1, t2);
+}
+#endif
+
+// 4 个包围盒的 slab 测试，未命中的通道输出无穷大
+static inline void slab4(const float* const mins[3], const float* const maxs[3],
+                         const float origin[3], const float invDir[3], const float extent[3], const bool parallel[3],
+                         float maxT, float out[4]) {
+#ifdef BVH_USE_SSE
+    __m128 tNear = _mm_setzero_ps();
+    __m128 tFar = _mm_set1_ps(maxT);
+    for (int a = 0; a < 3; a++) {
+        __m128 e = _mm_set1_ps(extent[a]);
+        __m128 axisNear, axisFar;
+        slabAxis4(_mm_sub_ps(_mm_load_ps(mins[a]), e), _mm_add_ps(_mm_load_ps(maxs[a]), e), origin[a], invDir[a], parallel[a],
+                  axisNear, axisFar);
+        tNear = _mm_max_ps(tNear, axisNear);
+        tFar = _mm_min_ps(tFar, axisFar);
+    }
+    __m128 hit = _mm_cmple_ps(tNear, tFar);
+    _mm_storeu_ps(out, _mm_or_ps(_mm_and_ps(hit, tNear), _mm_andnot_ps(hit, _mm_set1_ps(BVH_INF))));
+#else
+    for (int i = 0; i < 4; i++) {
+        float tNear = 0.0f;
+        float tFar = maxT;
+        for (int a = 0; a < 3; a++) {
+            float axisNear, axisFar;
+            slabAxis(mins[a][i] - extent[a], maxs[a][i] + extent[a], origin[a], invDir[a], parallel[a], axisNear, axisFar);
+            tNear = std::max(tNear, axisNear);
+            tFar = std::min(tFar, axisFar);
+        }
+        out[i] = tNear <= tFar ? tNear : BVH_INF;
+    }
+#endif
+}
+
+void Bvh::build(const std::vector<AABB>& boxes) {
+    nodes.clear();
+    packets.clear();
+    count = int(boxes.size());
+    if (boxes.empty()) {
+        return;
+    }
+
+    ids.resize(count);
+    std::iota(ids.begin(), ids.end(), 0);
+    centers.resize(size_t(count) * 3);
+    for (int i = 0; i < count; i++) {
+        QVector3D c = (boxes[i].min + boxes[i].max) * 0.5f;
+        centers[i * 3] = c.x();
+        centers[i * 3 + 1] = c.y();
+        centers[i * 3 + 2] = c.z();
+    }
+
+    nodes.reserve(size_t(count) / 2 + 1);
+    packets.reserve(size_t(count) / 2 + 1);
+    nodes.push_back(Node());
+    buildNode(0, 0, count, boxes);
+    builtArea = leafArea();
+}
+
+void Bvh::update(const std::vector<AABB>& boxes) {
+    if (nodes.empty() || int(boxes.size()) != count) {
+        build(boxes);
+        return;
+    }
+
+    // 孩子的下标总大于父节点，倒序遍历即自底向上
+    for (int n = int(nodes.size()) - 1; n >= 0; n--) {
+        Node& node = nodes[n];
+        for (int a = 0; a < 3; a++) {
+            node.min[a] = BVH_INF;
+            node.max[a] = -BVH_INF;
+        }
+        if (node.count > 0) {
+            Packet& packet = packets[node.first];
+            for (int lane = 0; lane < node.count; lane++) {
+                const AABB& box = boxes[packet.id[lane]];
+                packet.minX[lane] = box.min.x();
+                packet.minY[lane] = box.min.y();
+                packet.minZ[lane] = box.min.z();
+                packet.maxX[lane] = box.max.x();
+                packet.maxY[lane] = box.max.y();
+                packet.maxZ[lane] = box.max.z();
+                for (int a = 0; a < 3; a++) {
+                    node.min[a] = std::min(node.min[a], box.min[a]);
+                    node.max[a] = std::max(node.max[a], box.max[a]);
+                }
+            }
+            continue;
+        }
+        const Node& left = nodes[node.first];
+        const Node& right = nodes[node.first + 1];
+        for (int a = 0; a < 3; a++) {
+            node.min[a] = std::min(left.min[a], right.min[a]);
+            node.max[a] = std::max(left.max[a], right.max[a]);
+        }
+    }
+
+    if (leafArea() > builtArea * 2.0f) {
+        build(boxes);
+    }
+}
+
+float Bvh::leafArea() const {
+    float area = 0.0f;
+    for (const Node& node : nodes) {
+        if (node.count > 0) {
+            float x = node.max[0] - node.min[0];
+            float y = node.max[1] - node.min[1];
+            float z = node.max[2] - node.min[2];
+            area += x * y + y * z + z * x;
+        }
+    }
+    return area;
+}
+
+void Bvh::buildNode(int nodeIndex, int begin, int end, const std::vector<AABB>& boxes) {
+    Node node;
+    float centerMin[3] = { BVH_INF, BVH_INF, BVH_INF };
+    float centerMax[3] = { -BVH_INF, -BVH_INF, -BVH_INF };
+    for (int a = 0; a < 3; a++) {
+        node.min[a] = BVH_INF;
+        node.max[a] = -BVH_INF;
+    }
+    for (int i = begin; i < end; i++) {
+        const AABB& box = boxes[ids[i]];
+        for (int a = 0; a < 3; a++) {
+            node.min[a] = std::min(node.min[a], box.min[a]);
+            node.max[a] = std::max(node.max[a], box.max[a]);
+            centerMin[a] = std::min(centerMin[a], centers[ids[i] * 3 + a]);
+            centerMax[a] = std::max(centerMax[a], centers[ids[i] * 3 + a]);
+        }
+    }
+
+    if (end - begin <= 4) {
+        Packet packet = {};
+        for (int i = begin; i < end; i++) {
+            const AABB& box = boxes[ids[i]];
+            int lane = i - begin;
+            packet.minX[lane] = box.min.x();
+            packet.minY[lane] = box.min.y();
+            packet.minZ[lane] = box.min.z();
+            packet.maxX[lane] = box.max.x();
+            packet.maxY[lane] = box.max.y();
+            packet.maxZ[lane] = box.max.z();
+            packet.id[lane] = ids[i];
+        }
+        node.first = int(packets.size());
+        node.count = end - begin;
+        packets.push_back(packet);
+        nodes[nodeIndex] = node;
+        return;
+    }
+
+    // 按中心点分布最广的轴做中位数划分
+    int axis = 0;
+    for (int a = 1; a < 3; a++) {
+        if (centerMax[a] - centerMin[a] > centerMax[axis] - centerMin[axis]) {
+            axis = a;
+        }
+    }
+    int mid = (begin + end) / 2;
+    std::nth_element(ids.begin() + begin, ids.begin() + mid, ids.begin() + end, [this, axis](int a, int b) {
+        return centers[a * 3 + axis] < centers[b * 3 + axis];
+    });
+
+    int left = int(nodes.size());
+    nodes.push_back(Node());
+    nodes.push_back(Node());
+    node.first = left;
+    node.count = 0;
+    nodes[nodeIndex] = node;
+
+    buildNode(left, begin, mid, boxes);
+    buildNode(left + 1, mid, end, boxes);
+}
+
+Bvh::Query Bvh::makeQuery(const QVector3D& origin, const QVector3D& direction, const QVector3D& extent) {
+    Query query;
+    for (int a = 0; a < 3; a++) {
+        query.origin[a] = origin[a];
+        query.parallel[a] = std::abs(direction[a]) < BVH_PARALLEL;
+        query.invDir[a] = query.parallel[a] ? 0.0f : 1.0f / direction[a];
+        query.extent[a] = extent[a];
+    }
+    return query;
+}
+
+bool Bvh::intersectNode(const Node& node, const Query& query, float maxT, float& tEntry) const {
+    float tNear = 0.0f;
+    float tFar = maxT;
+    for (int a = 0; a < 3; a++) {
+        float axisNear, axisFar;
+        slabAxis(node.min[a] - query.extent[a], node.max[a] + query.extent[a], query.origin[a], query.invDir[a], query.parallel[a],
+                 axisNear, axisFar);
+        tNear = std::max(tNear, axisNear);
+        tFar = std::min(tFar, axisFar);
+    }
+    tEntry = tNear;
+    return tNear <= tFar;
+}
+
+// 由近到远遍历，visit 返回新的最大距离用于剪枝
+template <class Visit>
+void Bvh::traverse(const Query& query, float maxT, Visit&& visit) const {
+    if (nodes.empty()) {
+        return;
+    }
+
+    struct Entry {
+        int node;
+        float t;
+    };
+    Entry stack[64];
+    int size = 0;
+
+    float tRoot;
+    if (!intersectNode(nodes[0], query, maxT, tRoot)) {
+        return;
+    }
+    stack[size++] = { 0, tRoot };
+
+    while (size > 0) {
+        Entry entry = stack[--size];
+        if (entry.t > maxT) {
+            continue;
+        }
+
+        const Node& node = nodes[entry.node];
+        if (node.count > 0) {
+            const Packet& packet = packets[node.first];
+            float t[4];
+            const float* const mins[3] = { packet.minX, packet.minY, packet.minZ };
+            const float* const maxs[3] = { packet.maxX, packet.maxY, packet.maxZ };
+            slab4(mins, maxs, query.origin, query.invDir, query.extent, query.parallel, maxT, t);
+            for (int lane = 0; lane < node.count; lane++) {
+                if (t[lane] <= maxT) {
+                    maxT = visit(packet.id[lane], t[lane]);
+                }
+            }
+            continue;
+        }
+
+        float tLeft, tRight;
+        bool hitLeft = intersectNode(nodes[node.first], query, maxT, tLeft);
+        bool hitRight = intersectNode(nodes[node.first + 1], query, maxT, tRight);
+        if (hitLeft && hitRight) {
+            // 远的先入栈，近的先处理
+            if (tLeft <= tRight) {
+                stack[size++] = { node.first + 1, tRight };
+                stack[size++] = { node.first, tLeft };
+            } else {
+                stack[size++] = { node.first, tLeft };
+                stack[size++] = { node.first + 1, tRight };
+            }
+        } else if (hitLeft) {
+            stack[size++] = { node.first, tLeft };
+        } else if (hitRight) {
+            stack[size++] = { node.first + 1, tRight };
+        }
+    }
+}
+
+bool Bvh::raycast(const QVector3D& origin, const QVector3D& direction, float maxDistance, RayHit& hit) const {
+    Query query = makeQuery(origin, direction, QVector3D(0.0f, 0.0f, 0.0f));
+    hit = RayHit();
+    traverse(query, maxDistance, [&hit](int object, float t) {
+        if (hit.object < 0 || t < hit.t) {
+            hit.object = object;
+            hit.t = t;
+        }
+        return hit.t;
+    });
+    return hit.object >= 0;
+}
+
+void Bvh::raycastAll(const QVector3D& origin, const QVector3D& direction, float maxDistance, std::vector<RayHit>& hits) const {
+    Query query = makeQuery(origin, direction, QVector3D(0.0f, 0.0f, 0.0f));
+    hits.clear();
+    traverse(query, maxDistance, [&hits, maxDistance](int object, float t) {
+        RayHit hit;
+        hit.object = object;
+        hit.t = t;
+        hits.push_back(hit);
+        return maxDistance;
+    });
+    std::sort(hits.begin(), hits.end(), [](const RayHit& a, const RayHit& b) {
+        return a.t < b.t;
+    });
+}
+
+bool Bvh::sweep(const AABB& box, const QVector3D& delta, RayHit& hit) const {
+    // 扫掠等价于从盒心发出的射线与按盒半尺寸外扩的场景包围盒求交
+    QVector3D center = (box.min + box.max) * 0.5f;
+    QVector3D extent = (box.max - box.min) * 0.5f;
+    Query query = makeQuery(center, delta, extent);
+    hit = RayHit();
+    traverse(query, 1.0f, [&hit](int object, float t) {
+        if (hit.object < 0 || t < hit.t) {
+            hit.object = object;
+            hit.t = t;
+        }
+        return hit.t;
+    });
+    return hit.object >= 0;
+}
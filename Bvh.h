@@ -0,0 +1,72 @@
+#ifndef BVH_H
+#define BVH_H
+
+
+#include "AABB.h"
+#include <vector>
+
+struct RayHit {
+    int object = -1;    // 构建时传入的包围盒下标
+    float t = 0.0f;     // 射线参数，方向为单位向量时即距离
+};
+
+// 场景包围盒上的层次包围体（BVH）
+// 叶子最多 4 个包围盒，按 SoA 存放，射线-包围盒 slab 测试一次处理 4 个
+class Bvh {
+public:
+    void build(const std::vector<AABB>& boxes);
+    // 包围盒移动后保持树结构、自底向上重新拟合节点，O(n)；
+    // 个数变化或叶子表面积之和超过构建时的两倍（划分已明显变差）时改为重新构建
+    void update(const std::vector<AABB>& boxes);
+    bool empty() const { return nodes.empty(); }
+    int objectCount() const { return count; }
+
+    // 最近命中
+    bool raycast(const QVector3D& origin, const QVector3D& direction, float maxDistance, RayHit& hit) const;
+    // 全部命中，按距离排序
+    void raycastAll(const QVector3D& origin, const QVector3D& direction, float maxDistance, std::vector<RayHit>& hits) const;
+    // 包围盒沿线段 delta 扫掠，返回最先接触的物体，t 在 [0, 1] 内
+    bool sweep(const AABB& box, const QVector3D& delta, RayHit& hit) const;
+
+private:
+    // 内部节点 count == 0，左右孩子为 first、first + 1；叶子节点 first 为 packet 下标，count 为有效包围盒数
+    struct Node {
+        float min[3];
+        float max[3];
+        int first;
+        int count;
+    };
+
+    struct alignas(16) Packet {
+        float minX[4], minY[4], minZ[4];
+        float maxX[4], maxY[4], maxZ[4];
+        int id[4];
+    };
+
+    // 扫掠时把被测包围盒按 extent 外扩，普通射线 extent 为 0
+    // 与某轴平行（该方向分量为 0）时 invDir 不用，只看起点是否在该轴的 slab 内
+    struct Query {
+        float origin[3];
+        float invDir[3];
+        float extent[3];
+        bool parallel[3];
+    };
+
+    void buildNode(int nodeIndex, int begin, int end, const std::vector<AABB>& boxes);
+    float leafArea() const;
+    bool intersectNode(const Node& node, const Query& query, float maxT, float& tEntry) const;
+    template <class Visit>
+    void traverse(const Query& query, float maxT, Visit&& visit) const;
+
+    static Query makeQuery(const QVector3D& origin, const QVector3D& direction, const QVector3D& extent);
+
+    std::vector<Node> nodes;
+    std::vector<Packet> packets;
+    std::vector<int> ids;
+    std::vector<float> centers;
+    int count = 0;
+    float builtArea = 0.0f;
+};
+
+
+#endif // BVH_H
@@ -0,0 +1,293 @@
+#include "ChunkStreamer.h"
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include "GeometryPool.h"
+
+namespace {
+
+float distanceToBox(const QVector3D& point, const AABB& box) {
+    float dx = std::max({ box.min.x() - point.x(), 0.0f, point.x() - box.max.x() });
+    float dy = std::max({ box.min.y() - point.y(), 0.0f, point.y() - box.max.y() });
+    float dz = std::max({ box.min.z() - point.z(), 0.0f, point.z() - box.max.z() });
+    return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+}
+
+void ChunkLoader::setGrid(const BoxGrid& boxGrid, const std::vector<StreamChunk>& chunks) {
+    grid = boxGrid;
+    ranges = chunks;
+}
+
+void ChunkLoader::request(int chunk) {
+    QMutexLocker locker(&mutex);
+    requests.push_back(chunk);
+    condition.wakeOne();
+}
+
+void ChunkLoader::takeFinished(std::vector<LoadedChunk>& out) {
+    QMutexLocker locker(&mutex);
+    for (LoadedChunk& loaded : finished) {
+        out.push_back(std::move(loaded));
+    }
+    finished.clear();
+}
+
+void ChunkLoader::finish() {
+    {
+        QMutexLocker locker(&mutex);
+        finishing = true;
+        condition.wakeAll();
+    }
+    wait();
+    requests.clear();
+    finished.clear();
+    finishing = false;
+}
+
+LoadedChunk ChunkLoader::load(int chunk) const {
+    std::vector<BoxInstance> boxes;
+    grid.generate(ranges[chunk].begin, ranges[chunk].end, boxes);
+
+    // 与 SharedResources 中静态盒子的实例格式相同：位置、边长、纹理层
+    LoadedChunk loaded;
+    loaded.chunk = chunk;
+    loaded.instances.reserve(boxes.size() * VertexArrays::FLOATS_PER_INSTANCE);
+    for (const BoxInstance& box : boxes) {
+        loaded.instances.push_back(box.position.x());
+        loaded.instances.push_back(box.position.y());
+        loaded.instances.push_back(box.position.z());
+        loaded.instances.push_back(box.size);
+        loaded.instances.push_back(float(box.layer));
+    }
+    return loaded;
+}
+
+void ChunkLoader::run() {
+    while (true) {
+        int chunk = -1;
+        {
+            QMutexLocker locker(&mutex);
+            while (requests.empty() && !finishing) {
+                condition.wait(&mutex);
+            }
+            if (finishing) {
+                return;
+            }
+            chunk = requests.front();
+            requests.pop_front();
+        }
+        LoadedChunk loaded = load(chunk);
+        QMutexLocker locker(&mutex);
+        finished.push_back(std::move(loaded));
+    }
+}
+
+void ChunkStreamer::init(GLFunctions* functions, const Scene& scene) {
+    destroy();
+    if (!scene.streaming.enabled) {
+        return;
+    }
+    grid = scene.boxGrid;
+    config = scene.streaming;
+
+    // 块按网格下标划分，相邻块的范围首尾相接，不会重复或遗漏盒子
+    int boxesPerCell = std::max(1, int(std::lround(config.cellSize / grid.spacing)));
+    for (int axis = 0; axis < 3; axis++) {
+        cellBoxes[axis] = std::min(boxesPerCell, std::max(1, grid.count[axis]));
+        cellCounts[axis] = (grid.count[axis] + cellBoxes[axis] - 1) / cellBoxes[axis];
+    }
+    for (int x = 0; x < cellCounts[0]; x++) {
+        for (int y = 0; y < cellCounts[1]; y++) {
+            for (int z = 0; z < cellCounts[2]; z++) {
+                StreamChunk chunk;
+                chunk.begin = { x * cellBoxes[0], y * cellBoxes[1], z * cellBoxes[2] };
+                for (int axis = 0; axis < 3; axis++) {
+                    chunk.end[axis] = std::min(chunk.begin[axis] + cellBoxes[axis], grid.count[axis]);
+                }
+                chunk.bounds = grid.bounds(chunk.begin, chunk.end);
+                chunk.boxCount = (chunk.end[0] - chunk.begin[0]) * (chunk.end[1] - chunk.begin[1]) * (chunk.end[2] - chunk.begin[2]);
+                chunkTable.push_back(chunk);
+            }
+        }
+    }
+
+    // 每个槽能放下最大的一块，预算至少能放一块
+    slotInstances = cellBoxes[0] * cellBoxes[1] * cellBoxes[2];
+    qint64 slotBytes = qint64(slotInstances) * VertexArrays::FLOATS_PER_INSTANCE * sizeof(float);
+    slotTotal = int(std::clamp<qint64>(qint64(config.budgetKB) * 1024 / slotBytes, 1, qint64(chunkTable.size())));
+    instanceBuffer.create(functions);
+    functions->glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    functions->glBufferData(GL_ARRAY_BUFFER, slotTotal * slotBytes, nullptr, GL_DYNAMIC_DRAW);
+    functions->glBindBuffer(GL_ARRAY_BUFFER, 0);
+    instanceBuffer.setBytes(slotTotal * slotBytes);
+    for (int slot = slotTotal - 1; slot >= 0; slot--) {
+        freeSlots.push_back(slot);
+    }
+
+    loader.setGrid(grid, chunkTable);
+    loader.start();
+    qDebug().noquote() << QString("streaming: %1 boxes in %2 chunks of up to %3, %4 slots (%5 KB)")
+                              .arg(grid.total())
+                              .arg(chunkTable.size())
+                              .arg(slotInstances)
+                              .arg(slotTotal)
+                              .arg(slotTotal * slotBytes / 1024);
+}
+
+void ChunkStreamer::destroy() {
+    if (loader.isRunning()) {
+        loader.finish();
+    }
+    instanceBuffer.reset();
+    chunkTable.clear();
+    residentChunks.clear();
+    freeSlots.clear();
+    slotTotal = 0;
+    slotInstances = 0;
+    pendingLoads = 0;
+    frame = 0;
+    visit = 0;
+}
+
+qint64 ChunkStreamer::residentBytes() const {
+    qint64 instances = 0;
+    for (int index : residentChunks) {
+        instances += chunkTable[index].boxCount;
+    }
+    return instances * VertexArrays::FLOATS_PER_INSTANCE * sizeof(float);
+}
+
+void ChunkStreamer::update(GLFunctions* functions, const QVector3D& eye, const QVector3D& velocity, bool block, FrameStats& stats) {
+    if (!enabled()) {
+        return;
+    }
+
+    // 先标记本帧用到的块，淘汰时不会选中它们；需要的块按距离排在预取的块之前
+    wanted.clear();
+    // 同一帧中先调用的视图标记过的块仍加入本视图的请求，去重只看本次调用
+    visit++;
+    forChunksNear(eye, config.loadRadius, [&](int index, float distance) {
+        chunkTable[index].lastUsed = frame;
+        chunkTable[index].lastVisit = visit;
+        wanted.push_back({ distance, index, true });
+    });
+    QVector3D predicted = eye + velocity * config.prefetchSeconds;
+    forChunksNear(predicted, config.loadRadius, [&](int index, float distance) {
+        if (chunkTable[index].lastVisit == visit) {
+            return;
+        }
+        chunkTable[index].lastUsed = frame;
+        chunkTable[index].lastVisit = visit;
+        wanted.push_back({ config.loadRadius + distance, index, false });
+    });
+
+    finishedLoads.clear();
+    loader.takeFinished(finishedLoads);
+    for (const LoadedChunk& loaded : finishedLoads) {
+        pendingLoads--;
+        chunkTable[loaded.chunk].loading = false;
+        upload(functions, loaded, stats);
+    }
+
+    std::sort(wanted.begin(), wanted.end());
+    bool stalled = false;
+    for (const ChunkRequest& request : wanted) {
+        StreamChunk& chunk = chunkTable[request.chunk];
+        if (chunk.slot >= 0) {
+            continue;
+        }
+        if (block) {
+            upload(functions, loader.load(request.chunk), stats);
+        } else if (!chunk.loading && pendingLoads < MAX_PENDING_LOADS) {
+            loader.request(request.chunk);
+            chunk.loading = true;
+            pendingLoads++;
+        }
+        if (chunk.slot < 0 && request.needed) {
+            stalled = true;
+        }
+    }
+    if (stalled) {
+        stats.streamStallFrames++;
+    }
+    stats.streamResident = int(residentChunks.size());
+    stats.streamChunks = int(chunkTable.size());
+    stats.streamResidentBytes = residentBytes();
+    stats.streamBudgetBytes = budgetBytes();
+}
+
+template <typename Visit>
+void ChunkStreamer::forChunksNear(const QVector3D& center, float radius, Visit visit) const {
+    // 球的包围盒换算为块下标范围，再逐块按到包围盒的距离筛选
+    int low[3], high[3];
+    for (int axis = 0; axis < 3; axis++) {
+        float lowBox = (center[axis] - radius - grid.origin[axis]) / grid.spacing;
+        float highBox = (center[axis] + radius - grid.origin[axis]) / grid.spacing;
+        low[axis] = std::max(0, int(std::floor(lowBox)) / cellBoxes[axis]);
+        high[axis] = std::min(cellCounts[axis] - 1, int(std::ceil(highBox)) / cellBoxes[axis]);
+        if (highBox < 0.0f || low[axis] > high[axis]) {
+            return;
+        }
+    }
+    for (int x = low[0]; x <= high[0]; x++) {
+        for (int y = low[1]; y <= high[1]; y++) {
+            for (int z = low[2]; z <= high[2]; z++) {
+                int index = (x * cellCounts[1] + y) * cellCounts[2] + z;
+                float distance = distanceToBox(center, chunkTable[index].bounds);
+                if (distance <= radius) {
+                    visit(index, distance);
+                }
+            }
+        }
+    }
+}
+
+void ChunkStreamer::upload(GLFunctions* functions, const LoadedChunk& loaded, FrameStats& stats) {
+    StreamChunk& chunk = chunkTable[loaded.chunk];
+    if (chunk.slot >= 0) {
+        return;
+    }
+    // 相机已经离开的块只在有空闲槽时上传，不为它淘汰别的块
+    if (freeSlots.empty() && chunk.lastUsed != frame) {
+        return;
+    }
+    int slot = acquireSlot(stats);
+    if (slot < 0) {
+        return;
+    }
+    GLintptr offset = GLintptr(slot) * slotInstances * VertexArrays::FLOATS_PER_INSTANCE * sizeof(float);
+    functions->glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    functions->glBufferSubData(GL_ARRAY_BUFFER, offset, loaded.instances.size() * sizeof(float), loaded.instances.data());
+    functions->glBindBuffer(GL_ARRAY_BUFFER, 0);
+    chunk.slot = slot;
+    residentChunks.push_back(loaded.chunk);
+    stats.streamUploads++;
+}
+
+int ChunkStreamer::acquireSlot(FrameStats& stats) {
+    if (!freeSlots.empty()) {
+        int slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot;
+    }
+    // 本帧需要的块都不淘汰，预算放不下时由调用方计为缺块
+    int victim = -1;
+    for (int i = 0; i < int(residentChunks.size()); i++) {
+        const StreamChunk& chunk = chunkTable[residentChunks[i]];
+        if (chunk.lastUsed < frame && (victim < 0 || chunk.lastUsed < chunkTable[residentChunks[victim]].lastUsed)) {
+            victim = i;
+        }
+    }
+    if (victim < 0) {
+        return -1;
+    }
+    StreamChunk& evicted = chunkTable[residentChunks[victim]];
+    int slot = evicted.slot;
+    evicted.slot = -1;
+    residentChunks[victim] = residentChunks.back();
+    residentChunks.pop_back();
+    stats.streamEvictions++;
+    return slot;
+}
@@ -0,0 +1,128 @@
+#ifndef CHUNKSTREAMER_H
+#define CHUNKSTREAMER_H
+
+
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+#include <array>
+#include <deque>
+#include <vector>
+#include "AABB.h"
+#include "FrameStats.h"
+#include "GLFunctions.h"
+#include "GLResource.h"
+#include "Scene.h"
+
+// 网格盒子中的一块：下标范围、包围盒和所在的显存槽
+struct StreamChunk {
+    std::array<int, 3> begin = { 0, 0, 0 };
+    std::array<int, 3> end = { 0, 0, 0 };
+    AABB bounds;
+    int boxCount = 0;
+    int slot = -1;          // -1 表示不在显存中
+    bool loading = false;   // 已交给加载线程，尚未取回
+    quint64 lastUsed = 0;   // 最近一次在某个视图的需要或预取范围内的帧号，淘汰时取最小
+    quint64 lastVisit = 0;  // 最近一次被 update 标记时的调用序号，同一次调用中需要与预取不重复
+};
+
+// 本帧在范围内的块，needed 为相机附近的块，否则只是预取
+struct ChunkRequest {
+    float priority = 0.0f;
+    int chunk = -1;
+    bool needed = false;
+
+    bool operator<(const ChunkRequest& other) const { return priority < other.priority; }
+};
+
+// 加载完成、等待上传的逐实例数据
+struct LoadedChunk {
+    int chunk = -1;
+    std::vector<float> instances;
+};
+
+// 加载线程：按请求的先后生成块内盒子的逐实例数据，只读自己的网格副本
+class ChunkLoader : public QThread {
+public:
+    void setGrid(const BoxGrid& boxGrid, const std::vector<StreamChunk>& chunks);
+    void request(int chunk);
+    // 取走已完成的块，不等待
+    void takeFinished(std::vector<LoadedChunk>& out);
+    // 丢弃未开始的请求并退出
+    void finish();
+
+    // 在调用线程中生成一块，渲染服务等不能等待的场合使用
+    LoadedChunk load(int chunk) const;
+
+protected:
+    void run() override;
+
+private:
+    BoxGrid grid;
+    std::vector<StreamChunk> ranges;
+    QMutex mutex;
+    QWaitCondition condition;
+    std::deque<int> requests;
+    std::vector<LoadedChunk> finished;
+    bool finishing = false;
+};
+
+// 网格盒子的分块流式加载：按相机位置与速度请求块，加载线程生成数据，
+// 调用 update 的线程把取回的块上传到共享实例缓冲中的固定大小槽位，槽用满时淘汰最久未用的块
+// 槽位数由显存预算决定，实例缓冲在 init 时一次分配，之后只做 glBufferSubData
+class ChunkStreamer {
+public:
+    // 以下调用都需要共享组中的某个上下文为当前上下文
+    void init(GLFunctions* functions, const Scene& scene);
+    void destroy();
+
+    bool enabled() const { return slotTotal > 0; }
+    GLuint buffer() const { return instanceBuffer; }
+    int slotCount() const { return slotTotal; }
+    int slotCapacity() const { return slotInstances; }
+
+    // 每个模拟帧由推进场景的一方调用一次，之后各视图的 update 共用这一帧号
+    void beginFrame() { frame++; }
+    // 每个视图每帧调用一次：上传已加载的块，标记相机附近与预测位置附近的块，请求缺少的块
+    // 本帧任一视图标记过的块都不会被淘汰，多视口时驻留集是各视图所需的并集
+    // 相机附近仍有块不在显存中时记为一帧卡顿；block 为 true 时缺少的块当场生成上传，不会卡顿
+    void update(GLFunctions* functions, const QVector3D& eye, const QVector3D& velocity, bool block, FrameStats& stats);
+
+    const std::vector<StreamChunk>& chunks() const { return chunkTable; }
+    // 已上传到显存的块在 chunks() 中的下标
+    const std::vector<int>& resident() const { return residentChunks; }
+    qint64 residentBytes() const;
+    qint64 budgetBytes() const { return instanceBuffer.bytes(); }
+
+private:
+    // 与球相交的块依次调用 visit(下标, 到球心的距离)
+    template <typename Visit>
+    void forChunksNear(const QVector3D& center, float radius, Visit visit) const;
+    void upload(GLFunctions* functions, const LoadedChunk& loaded, FrameStats& stats);
+    // 取一个空闲槽，没有时淘汰本帧不需要的最久未用块，仍没有时返回 -1
+    int acquireSlot(FrameStats& stats);
+
+    static const int MAX_PENDING_LOADS = 8;
+
+    BoxGrid grid;
+    StreamingConfig config;
+    std::array<int, 3> cellBoxes = { 1, 1, 1 };
+    std::array<int, 3> cellCounts = { 0, 0, 0 };
+    std::vector<StreamChunk> chunkTable;
+    std::vector<int> residentChunks;
+    std::vector<int> freeSlots;
+    int slotTotal = 0;
+    int slotInstances = 0;
+    GLBuffer instanceBuffer;
+    ChunkLoader loader;
+    int pendingLoads = 0;
+    quint64 frame = 0;
+    quint64 visit = 0;
+
+    std::vector<LoadedChunk> finishedLoads;
+    std::vector<ChunkRequest> wanted;
+};
+
+
+#endif // CHUNKSTREAMER_H
@@ -0,0 +1,192 @@
+#include "FrameCapture.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QMutexLocker>
+
+void CaptureWriter::setOutput(const QString& directory, CaptureFormat format) {
+    this->directory = directory;
+    this->format = format;
+    finishing = false;
+    lastWritten.store(-1, std::memory_order_relaxed);
+}
+
+void CaptureWriter::enqueue(const CapturedFrame& frame) {
+    QMutexLocker locker(&mutex);
+    queue.push_back(frame);
+    condition.wakeOne();
+}
+
+void CaptureWriter::finish() {
+    {
+        QMutexLocker locker(&mutex);
+        finishing = true;
+        condition.wakeAll();
+    }
+    wait();
+}
+
+void CaptureWriter::run() {
+    while (true) {
+        CapturedFrame frame;
+        {
+            QMutexLocker locker(&mutex);
+            while (queue.empty() && !finishing) {
+                condition.wait(&mutex);
+            }
+            if (queue.empty()) {
+                return;
+            }
+            frame = queue.front();
+            queue.pop_front();
+        }
+        write(frame);
+        lastWritten.store(frame.index, std::memory_order_release);
+    }
+}
+
+void CaptureWriter::write(const CapturedFrame& frame) {
+    QString name = QString("%1/frame_%2").arg(directory).arg(frame.index, 6, 10, QChar('0'));
+    if (format == CaptureFormat::Png) {
+        // GL 的行序自下而上，保存前上下翻转
+        QImage image(frame.pixels, frame.width, frame.height, QImage::Format_RGBA8888);
+        if (!image.mirrored().save(name + ".png")) {
+            qDebug() << "Failed to write capture frame!" << name;
+        }
+    } else {
+        QFile file(name + ".rgba");
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qDebug() << "Failed to write capture frame!" << name;
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(frame.pixels), frame.bytes);
+    }
+}
+
+bool FrameCapture::start(GLFunctions* functions, const QString& directory, CaptureFormat format) {
+    stop();
+    if (!QDir().mkpath(directory)) {
+        qDebug() << "Failed to create capture directory!" << directory;
+        return false;
+    }
+
+    gl = functions;
+    for (Slot& slot : ring) {
+        slot = Slot();
+        slot.pbo.create(gl);
+    }
+    nextSlot = 0;
+    frameIndex = 0;
+    dropped = 0;
+
+    writer.setOutput(directory, format);
+    writer.start();
+    active = true;
+    return true;
+}
+
+void FrameCapture::stop() {
+    if (!active) {
+        return;
+    }
+
+    // 写盘线程读完所有映射内存后才能解除映射
+    collectReady(true);
+    writer.finish();
+    releaseWritten();
+    for (Slot& slot : ring) {
+        slot = Slot();
+    }
+    active = false;
+    qDebug() << "Capture finished:" << frameIndex << "frames," << dropped << "dropped";
+}
+
+void FrameCapture::capture(GLuint framebuffer, int width, int height) {
+    if (!active) {
+        return;
+    }
+
+    releaseWritten();
+    collectReady(false);
+
+    // 最旧的槽仍在回读或写盘说明 GPU 或写盘跟不上，丢弃本帧而不是阻塞渲染线程
+    Slot& slot = ring[nextSlot];
+    if (slot.fence || slot.mapped) {
+        dropped++;
+        return;
+    }
+
+    GLsizeiptr size = GLsizeiptr(width) * height * 4;
+    gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    if (slot.size != size) {
+        gl->glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        slot.pbo.setBytes(size);
+        slot.size = size;
+    }
+    gl->glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    gl->glReadBuffer(GL_COLOR_ATTACHMENT0);
+    gl->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    // 绑定 PBO 时 glReadPixels 只排入命令，数据由 GPU 异步写入缓冲
+    gl->glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.index = frameIndex++;
+    slot.width = width;
+    slot.height = height;
+    nextSlot = (nextSlot + 1) % RING_SIZE;
+}
+
+void FrameCapture::collectReady(bool wait) {
+    // 从最旧的槽开始，遇到未完成的就停下，保证帧按顺序入队
+    for (int i = 0; i < RING_SIZE; i++) {
+        Slot& slot = ring[(nextSlot + i) % RING_SIZE];
+        if (slot.fence && !collect(slot, wait)) {
+            return;
+        }
+    }
+}
+
+bool FrameCapture::collect(Slot& slot, bool wait) {
+    GLenum status = gl->glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? GL_TIMEOUT_IGNORED : 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        return false;
+    }
+    gl->glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    const void* data = gl->glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.size, GL_MAP_READ_BIT);
+    if (data) {
+        // 保持映射，写盘线程直接从映射内存保存，写完后由 releaseWritten 解除
+        CapturedFrame frame;
+        frame.index = slot.index;
+        frame.width = slot.width;
+        frame.height = slot.height;
+        frame.pixels = static_cast<const uchar*>(data);
+        frame.bytes = qsizetype(slot.size);
+        slot.mapped = true;
+        writer.enqueue(frame);
+    } else {
+        qDebug() << "Failed to map capture buffer!";
+    }
+    gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
+
+void FrameCapture::releaseWritten() {
+    int written = writer.writtenIndex();
+    bool released = false;
+    for (Slot& slot : ring) {
+        if (slot.mapped && slot.index <= written) {
+            gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+            gl->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            slot.mapped = false;
+            released = true;
+        }
+    }
+    if (released) {
+        gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+#include <atomic>
+#include <deque>
+#include "GLFunctions.h"
+#include "GLResource.h"
+
+enum class CaptureFormat {
+    Png,
+    Raw
+};
+
+// 一帧回读完成的像素，自下而上存放的 RGBA8；指向仍处于映射状态的 PBO，写完前不会被解除映射
+struct CapturedFrame {
+    int index = 0;
+    int width = 0;
+    int height = 0;
+    const uchar* pixels = nullptr;
+    qsizetype bytes = 0;
+};
+
+// 写盘线程：从队列取帧，写成 PNG 或原始 RGBA 序列
+class CaptureWriter : public QThread {
+public:
+    void setOutput(const QString& directory, CaptureFormat format);
+    void enqueue(const CapturedFrame& frame);
+    // 写完队列中剩余的帧后退出
+    void finish();
+    // 已写完的最后一帧序号，帧按序号顺序写出，不大于它的帧的像素可以释放
+    int writtenIndex() const { return lastWritten.load(std::memory_order_acquire); }
+
+protected:
+    void run() override;
+
+private:
+    void write(const CapturedFrame& frame);
+
+    QString directory;
+    CaptureFormat format = CaptureFormat::Png;
+    QMutex mutex;
+    QWaitCondition condition;
+    std::deque<CapturedFrame> queue;
+    bool finishing = false;
+    std::atomic<int> lastWritten{ -1 };
+};
+
+// 异步帧捕获：glReadPixels 写入 PBO 环，等栅栏触发后再映射，写盘线程直接读取映射内存，
+// 渲染线程既不等待回读也不拷贝像素
+class FrameCapture {
+public:
+    bool start(GLFunctions* functions, const QString& directory, CaptureFormat format);
+    // 同步取回所有未完成的回读并等待写盘结束，调用时需有当前上下文
+    void stop();
+    bool isActive() const { return active; }
+
+    // 从 framebuffer 的颜色附件 0 发起本帧回读，并收取已完成的旧回读
+    void capture(GLuint framebuffer, int width, int height);
+
+    int capturedFrames() const { return frameIndex; }
+    int droppedFrames() const { return dropped; }
+
+private:
+    // 除了 GPU 上未完成的回读，还要容纳已映射、排队或正在写盘的帧
+    static const int RING_SIZE = 8;
+
+    struct Slot {
+        GLBuffer pbo;
+        GLsizeiptr size = 0;
+        GLsync fence = nullptr;
+        bool mapped = false;
+        int index = 0;
+        int width = 0;
+        int height = 0;
+    };
+
+    // 按提交顺序收取栅栏已触发的回读，映射后交给写盘线程；wait 为 true 时阻塞等待
+    bool collect(Slot& slot, bool wait);
+    void collectReady(bool wait);
+    // 解除写盘线程已写完的帧的映射
+    void releaseWritten();
+
+    GLFunctions* gl = nullptr;
+    Slot ring[RING_SIZE];
+    int nextSlot = 0;
+    int frameIndex = 0;
+    int dropped = 0;
+    bool active = false;
+    CaptureWriter writer;
+};
+
+
+#endif // FRAMECAPTURE_H
@@ -0,0 +1,71 @@
+#include "FramePipeline.h"
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cstring>
+
+void FramePipeline::init(GLFunctions* functions, int frameCount) {
+    gl = functions;
+    frames.assign(std::clamp(frameCount, 1, MAX_DEPTH), Slot());
+    current = 0;
+
+    // 各槽的偏移需满足 glBindBufferRange 的对齐要求
+    GLint alignment = 256;
+    gl->glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    uniformStride = (GLsizeiptr(sizeof(FrameUniforms)) + alignment - 1) / alignment * alignment;
+
+    uniformBuffer.create(gl);
+    gl->glBindBuffer(GL_UNIFORM_BUFFER, uniformBuffer);
+    gl->glBufferData(GL_UNIFORM_BUFFER, uniformStride * depth(), nullptr, GL_DYNAMIC_DRAW);
+    uniformBuffer.setBytes(uniformStride * depth());
+    gl->glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void FramePipeline::destroy() {
+    if (!gl) {
+        return;
+    }
+    for (Slot& frame : frames) {
+        if (frame.fence) {
+            gl->glDeleteSync(frame.fence);
+        }
+    }
+    frames.clear();
+    uniformBuffer.reset();
+    gl = nullptr;
+}
+
+void FramePipeline::beginFrame(const QMatrix4x4& view, const QMatrix4x4& projection, FrameStats& stats) {
+    Slot& frame = frames[current];
+    if (frame.fence) {
+        // 只有 GPU 落后超过 depth 帧时才真正等待
+        QElapsedTimer waitTimer;
+        waitTimer.start();
+        gl->glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        double waitMs = waitTimer.nsecsElapsed() / 1000000.0;
+        gl->glDeleteSync(frame.fence);
+        frame.fence = nullptr;
+        stats.fenceWaitMsSum += waitMs;
+        stats.fenceWaitMsMax = std::max(stats.fenceWaitMsMax, waitMs);
+        stats.fenceWaitSamples++;
+    }
+
+    // 槽已空闲，不同步映射直接写入，驱动无需拷贝或等待
+    GLintptr offset = uniformStride * current;
+    gl->glBindBuffer(GL_UNIFORM_BUFFER, uniformBuffer);
+    void* data = gl->glMapBufferRange(GL_UNIFORM_BUFFER, offset, sizeof(FrameUniforms),
+                                      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (data) {
+        FrameUniforms uniforms;
+        std::memcpy(uniforms.view, view.constData(), sizeof(uniforms.view));
+        std::memcpy(uniforms.projection, projection.constData(), sizeof(uniforms.projection));
+        std::memcpy(data, &uniforms, sizeof(uniforms));
+        gl->glUnmapBuffer(GL_UNIFORM_BUFFER);
+    }
+    gl->glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    gl->glBindBufferRange(GL_UNIFORM_BUFFER, UNIFORM_BINDING, uniformBuffer, offset, sizeof(FrameUniforms));
+}
+
+void FramePipeline::endFrame() {
+    frames[current].fence = gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    current = (current + 1) % depth();
+}
@@ -0,0 +1,46 @@
+#ifndef FRAMEPIPELINE_H
+#define FRAMEPIPELINE_H
+
+
+#include <QMatrix4x4>
+#include <vector>
+#include "FrameStats.h"
+#include "GLFunctions.h"
+#include "GLResource.h"
+
+// 每帧的相机参数，对应着色器中 std140 布局的 Frame 块
+struct FrameUniforms {
+    float view[16];
+    float projection[16];
+};
+
+// 多帧并行：每个槽有自己的每帧数据，GPU 用完（fence 触发）后才重新写入
+// CPU 最多领先 GPU depth 帧，写入时不必与 GPU 隐式同步
+class FramePipeline {
+public:
+    static constexpr GLuint UNIFORM_BINDING = 0;    // Frame 块的绑定点
+    static constexpr int MAX_DEPTH = 3;
+
+    void init(GLFunctions* functions, int frameCount);
+    void destroy();
+    int depth() const { return int(frames.size()); }
+
+    // 等待本槽上一次使用的帧完成，再写入并绑定本帧的相机参数
+    void beginFrame(const QMatrix4x4& view, const QMatrix4x4& projection, FrameStats& stats);
+    // 本帧命令全部提交后调用
+    void endFrame();
+
+private:
+    struct Slot {
+        GLsync fence = nullptr;
+    };
+
+    GLFunctions* gl = nullptr;
+    std::vector<Slot> frames;
+    int current = 0;
+    GLBuffer uniformBuffer;     // 各槽的 FrameUniforms 按对齐要求依次存放
+    GLsizeiptr uniformStride = 0;
+};
+
+
+#endif // FRAMEPIPELINE_H
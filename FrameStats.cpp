@@ -0,0 +1,93 @@
+#include "FrameStats.h"
+#include "GLFunctions.h"
+#include "Scene.h"
+#include "SharedResources.h"
+
+QString FrameStats::format(double seconds, const SharedResources& resources, const Scene& scene, int framesInFlight,
+                           const GLCallCounts* calls) const {
+    QString message = QString("fps %1").arg(frames / seconds, 0, 'f', 1);
+    if (frameIntervalSamples > 0) {
+        message += QString(", frame interval avg %1 ms max %2 ms")
+                       .arg(frameIntervalSum / frameIntervalSamples, 0, 'f', 2)
+                       .arg(frameIntervalMax, 0, 'f', 2);
+    }
+    message += QString(", draw calls/frame %1, texture binds/frame %2")
+                   .arg(frames ? double(drawCalls) / frames : 0.0, 0, 'f', 1)
+                   .arg(frames ? double(textureBinds) / frames : 0.0, 0, 'f', 1);
+    if (overdrawSamples > 0) {
+        message += QString(", overdraw %1").arg(overdrawSum / overdrawSamples, 0, 'f', 2);
+    }
+    if (occlusionTested > 0) {
+        message += QString(", occluded %1/%2 tested")
+                       .arg(occlusionCulled)
+                       .arg(occlusionTested);
+    }
+    if (fenceWaitSamples > 0) {
+        message += QString(", %1 frames in flight, fence wait avg %2 ms max %3 ms")
+                       .arg(framesInFlight)
+                       .arg(fenceWaitMsSum / fenceWaitSamples, 0, 'f', 3)
+                       .arg(fenceWaitMsMax, 0, 'f', 3);
+    }
+    if (drawListSamples > 0) {
+        message += QString(", draw list %1 ms on %2 threads, frustum culled %3/frame")
+                       .arg(drawListMsSum / drawListSamples, 0, 'f', 3)
+                       .arg(resources.jobs.threadCount())
+                       .arg(double(frustumCulled) / drawListSamples, 0, 'f', 1);
+    }
+    if (!resources.proxies.isEmpty() && frames > 0) {
+        message += QString(", proxies %1/frame, box clusters %2/frame")
+                       .arg(double(proxyDraws) / frames, 0, 'f', 1)
+                       .arg(double(clusterDraws) / frames, 0, 'f', 1);
+    }
+    if (streamChunks > 0) {
+        message += QString(", streaming %1/%2 chunks resident (%3 of %4 KB), uploads %5, evictions %6, stall frames %7")
+                       .arg(streamResident)
+                       .arg(streamChunks)
+                       .arg(streamResidentBytes / 1024)
+                       .arg(streamBudgetBytes / 1024)
+                       .arg(streamUploads)
+                       .arg(streamEvictions)
+                       .arg(streamStallFrames);
+    }
+    if (shaderCompiles > 0) {
+        message += QString(", shaders compiled %1 (%2 ms, %3 variants total)")
+                       .arg(shaderCompiles)
+                       .arg(shaderCompileMsSum, 0, 'f', 2)
+                       .arg(resources.shaders.compiledCount());
+    }
+    if (calls && frames > 0) {
+        message += QString(", gl calls/frame: draws %1 binds %2 uniforms %3 uploads %4 state %5, errors %6")
+                       .arg(double(calls->draws) / frames, 0, 'f', 1)
+                       .arg(double(calls->binds) / frames, 0, 'f', 1)
+                       .arg(double(calls->uniforms) / frames, 0, 'f', 1)
+                       .arg(double(calls->uploads) / frames, 0, 'f', 1)
+                       .arg(double(calls->state) / frames, 0, 'f', 1)
+                       .arg(calls->errors);
+    }
+    if (inputLatencySamples > 0) {
+        message += QString(", input latency avg %1 ms max %2 ms")
+                       .arg(inputLatencySum / inputLatencySamples, 0, 'f', 2)
+                       .arg(inputLatencyMax, 0, 'f', 2);
+    }
+    if (physicsSamples > 0) {
+        message += QString(", bodies awake %1/%2, physics %3 ms")
+                       .arg(scene.awakeBodies())
+                       .arg(int(scene.bodies.size()))
+                       .arg(physicsMsSum / physicsSamples, 0, 'f', 4);
+    }
+    if (repaintRequests > 0) {
+        message += QString(", repaints %1 requested %2 coalesced").arg(repaintRequests).arg(redundantRepaints);
+    }
+    if (particleSamples > 0) {
+        message += QString(", particles %1 (%2) update %3 ms")
+                       .arg(resources.particles.count())
+                       .arg(resources.particles.isGpu() ? "gpu" : "cpu")
+                       .arg(particleMsSum / particleSamples, 0, 'f', 3);
+    }
+    if (captureSamples > 0) {
+        message += QString(", capture %1 ms/frame (%2 dropped)")
+                       .arg(captureMsSum / captureSamples, 0, 'f', 3)
+                       .arg(captureDropped);
+    }
+    return message;
+}
@@ -0,0 +1,89 @@
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+
+#include <QString>
+
+class Scene;
+class SharedResources;
+struct GLCallCounts;
+
+// 帧统计：按帧累加，每秒输出一次后清零
+struct FrameStats {
+    int frames = 0;
+    int drawCalls = 0;
+    int textureBinds = 0;
+
+    // 模板缓冲统计的平均每像素片元数
+    double overdrawSum = 0.0;
+    int overdrawSamples = 0;
+
+    // 遮挡查询：读回结果的物体数与其中被完全遮挡、跳过着色的物体数
+    int occlusionTested = 0;
+    int occlusionCulled = 0;
+
+    // 输入到画面交换的延迟（毫秒）
+    double inputLatencySum = 0.0;
+    double inputLatencyMax = 0.0;
+    int inputLatencySamples = 0;
+
+    // 重绘请求数与被合并掉的多余请求数
+    int repaintRequests = 0;
+    int redundantRepaints = 0;
+
+    // 刚体模拟耗时（毫秒），物体全部休眠时接近 0
+    double physicsMsSum = 0.0;
+    int physicsSamples = 0;
+
+    // 粒子积分在渲染线程上的耗时（毫秒），GPU 模式下只是提交命令的时间
+    double particleMsSum = 0.0;
+    int particleSamples = 0;
+
+    // 帧捕获在渲染线程上的耗时（毫秒）
+    double captureMsSum = 0.0;
+    int captureSamples = 0;
+    int captureDropped = 0;     // 写入线程来不及而丢弃的累计帧数
+
+    // 开始新一帧前等待该槽上一帧 fence 的 CPU 时间（毫秒），GPU 跟得上时接近 0
+    double fenceWaitMsSum = 0.0;
+    double fenceWaitMsMax = 0.0;
+    int fenceWaitSamples = 0;
+
+    // 独立渲染线程上相邻两帧开始的间隔（毫秒），衡量帧时间抖动
+    double frameIntervalSum = 0.0;
+    double frameIntervalMax = 0.0;
+    int frameIntervalSamples = 0;
+
+    // 着色器变体的按需编译与预热（毫秒），首次用到某个变体的帧会明显变慢
+    int shaderCompiles = 0;
+    double shaderCompileMsSum = 0.0;
+
+    // 准备绘制列表的耗时（毫秒，含并行的视锥剔除与合并）和被视锥剔除的物体数
+    double drawListMsSum = 0.0;
+    int drawListSamples = 0;
+    int frustumCulled = 0;
+
+    // 分块流式加载：上传与淘汰的块数，相机附近仍有块不在显存中的帧数
+    int streamUploads = 0;
+    int streamEvictions = 0;
+    int streamStallFrames = 0;
+    // 最近一帧的驻留块数、总块数与显存，由调用 ChunkStreamer::update 的线程写入
+    int streamResident = 0;
+    int streamChunks = 0;
+    qint64 streamResidentBytes = 0;
+    qint64 streamBudgetBytes = 0;
+
+    // 远处盒子的代理：绘制的代理网格数与按原样实例化绘制的叶簇数
+    int proxyDraws = 0;
+    int clusterDraws = 0;
+
+    void reset() { *this = FrameStats(); }
+
+    // 每秒输出的一行统计，只列出有样本的项；resources 只读取初始化后不变的部分，
+    // scene 只在本统计含物理样本时读取；calls 为 GL_TRACE 下的调用计数，为空时不输出
+    QString format(double seconds, const SharedResources& resources, const Scene& scene, int framesInFlight,
+                   const GLCallCounts* calls = nullptr) const;
+};
+
+
+#endif // FRAMESTATS_H
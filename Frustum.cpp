@@ -0,0 +1,31 @@
+#include "Frustum.h"
+
+Frustum Frustum::fromMatrix(const QMatrix4x4& viewProjection) {
+    QVector4D x = viewProjection.row(0);
+    QVector4D y = viewProjection.row(1);
+    QVector4D z = viewProjection.row(2);
+    QVector4D w = viewProjection.row(3);
+
+    // 依次为左、右、下、上、近、远平面：裁剪空间中 -w <= x, y, z <= w
+    Frustum frustum;
+    frustum.planes[0] = w + x;
+    frustum.planes[1] = w - x;
+    frustum.planes[2] = w + y;
+    frustum.planes[3] = w - y;
+    frustum.planes[4] = w + z;
+    frustum.planes[5] = w - z;
+    return frustum;
+}
+
+bool Frustum::intersects(const AABB& box) const {
+    for (const QVector4D& plane : planes) {
+        // 取包围盒在平面法线方向上最靠前的顶点，它在外侧则整个盒子都在外侧
+        float x = plane.x() >= 0.0f ? box.max.x() : box.min.x();
+        float y = plane.y() >= 0.0f ? box.max.y() : box.min.y();
+        float z = plane.z() >= 0.0f ? box.max.z() : box.min.z();
+        if (plane.x() * x + plane.y() * y + plane.z() * z + plane.w() < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
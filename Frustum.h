@@ -0,0 +1,20 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+
+#include <QMatrix4x4>
+#include <QVector4D>
+#include "AABB.h"
+
+// 视锥体：从投影与相机矩阵之积的行向量提取六个平面，法线朝内
+struct Frustum {
+    QVector4D planes[6];
+
+    static Frustum fromMatrix(const QMatrix4x4& viewProjection);
+
+    // 包围盒完全在某个平面外侧时不可见；是保守判断，靠近视锥角落的盒子可能仍算可见
+    bool intersects(const AABB& box) const;
+};
+
+
+#endif // FRUSTUM_H
@@ -0,0 +1,45 @@
+#include "GLFunctions.h"
+
+#ifdef GL_TRACE
+
+#include <QDebug>
+#include <QOpenGLContext>
+#include <QOpenGLDebugLogger>
+
+void TracedGLFunctions::startValidation() {
+    QOpenGLContext* context = QOpenGLContext::currentContext();
+    if (context && context->hasExtension("GL_KHR_debug")) {
+        // 日志对象随上下文销毁
+        QOpenGLDebugLogger* logger = new QOpenGLDebugLogger(context);
+        if (logger->initialize()) {
+            GLCallCounts* errorCounts = &counts;
+            QObject::connect(logger, &QOpenGLDebugLogger::messageLogged, [errorCounts](const QOpenGLDebugMessage& message) {
+                if (message.severity() == QOpenGLDebugMessage::NotificationSeverity) {
+                    return;
+                }
+                if (message.type() == QOpenGLDebugMessage::ErrorType) {
+                    errorCounts->errors++;
+                }
+                qDebug() << "GL debug:" << message.message();
+            });
+            logger->startLogging(QOpenGLDebugLogger::SynchronousLogging);
+            checkErrors = false;
+            return;
+        }
+        delete logger;
+    }
+    qDebug() << "GL_KHR_debug unavailable, checking glGetError after each call";
+    checkErrors = true;
+}
+
+void TracedGLFunctions::check(const char* call) {
+    if (!checkErrors) {
+        return;
+    }
+    for (GLenum error = glGetError(); error != GL_NO_ERROR; error = glGetError()) {
+        counts.errors++;
+        qDebug() << "GL error" << QString::number(error, 16).prepend("0x") << "after" << call;
+    }
+}
+
+#endif
@@ -0,0 +1,416 @@
+#ifndef GLFUNCTIONS_H
+#define GLFUNCTIONS_H
+
+
+#include <QOpenGLFunctions_3_3_Core>
+
+// 每帧各类 GL 调用的次数，用于定位驱动开销
+struct GLCallCounts {
+    int draws = 0;      // 绘制、清除与 blit
+    int binds = 0;      // 缓冲（含区间）、纹理、VAO、帧缓冲的绑定，纹理单元切换与 uniform 块绑定
+    int uniforms = 0;   // uniform 上传
+    int uploads = 0;    // 缓冲与纹理数据的上传、回读，缓冲映射与解除映射
+    int state = 0;      // 其余状态：开关、深度/模板/颜色写入、视口、查询、条件渲染、变换反馈、同步
+    int errors = 0;     // glGetError 或 KHR_debug 报告的错误
+
+    void reset() { *this = GLCallCounts(); }
+    GLCallCounts& operator+=(const GLCallCounts& other) {
+        draws += other.draws;
+        binds += other.binds;
+        uniforms += other.uniforms;
+        uploads += other.uploads;
+        state += other.state;
+        errors += other.errors;
+        return *this;
+    }
+};
+
+#ifdef GL_TRACE
+
+// 以 GL_TRACE 编译时，同名成员函数遮蔽基类的入口：先计数，再调用原函数，
+// 不支持 KHR_debug 时在每次调用后检查 glGetError。项目经函数表调用的入口都在这里；
+// 创建对象、挂接附件、设置顶点格式与查询常量的调用只检查错误、不计数。
+// 不经函数表的调用不在统计内：QOpenGLShaderProgram 的 bind/release 与链接，
+// 以及 GLHandle 经上下文的 extraFunctions 删除对象；项目不使用 setUniformValue，uniform 都经 glUniform*
+class TracedGLFunctions : public QOpenGLFunctions_3_3_Core {
+public:
+    // 需在上下文为当前时调用：有 GL_KHR_debug 时改用调试输出同步报告错误
+    void startValidation();
+    // 同一上下文中的另一套函数表沿用已建立的校验方式，错误只报告一次
+    void shareValidation(const TracedGLFunctions& functions) { checkErrors = functions.checkErrors; }
+
+    GLCallCounts& callCounts() { return counts; }
+
+    void glDrawArrays(GLenum mode, GLint first, GLsizei count) {
+        counts.draws++;
+        QOpenGLFunctions_3_3_Core::glDrawArrays(mode, first, count);
+        check("glDrawArrays");
+    }
+    void glDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLint basevertex) {
+        counts.draws++;
+        QOpenGLFunctions_3_3_Core::glDrawElementsBaseVertex(mode, count, type, indices, basevertex);
+        check("glDrawElementsBaseVertex");
+    }
+    void glDrawElementsInstancedBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount, GLint basevertex) {
+        counts.draws++;
+        QOpenGLFunctions_3_3_Core::glDrawElementsInstancedBaseVertex(mode, count, type, indices, instancecount, basevertex);
+        check("glDrawElementsInstancedBaseVertex");
+    }
+    void glMultiDrawElementsBaseVertex(GLenum mode, const GLsizei* count, GLenum type, const void* const* indices, GLsizei drawcount, const GLint* basevertex) {
+        counts.draws++;
+        QOpenGLFunctions_3_3_Core::glMultiDrawElementsBaseVertex(mode, count, type, indices, drawcount, basevertex);
+        check("glMultiDrawElementsBaseVertex");
+    }
+    void glClear(GLbitfield mask) {
+        counts.draws++;
+        QOpenGLFunctions_3_3_Core::glClear(mask);
+        check("glClear");
+    }
+    void glBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter) {
+        counts.draws++;
+        QOpenGLFunctions_3_3_Core::glBlitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+        check("glBlitFramebuffer");
+    }
+
+    void glBindBuffer(GLenum target, GLuint buffer) {
+        counts.binds++;
+        QOpenGLFunctions_3_3_Core::glBindBuffer(target, buffer);
+        check("glBindBuffer");
+    }
+    void glBindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+        counts.binds++;
+        QOpenGLFunctions_3_3_Core::glBindBufferBase(target, index, buffer);
+        check("glBindBufferBase");
+    }
+    void glBindTexture(GLenum target, GLuint texture) {
+        counts.binds++;
+        QOpenGLFunctions_3_3_Core::glBindTexture(target, texture);
+        check("glBindTexture");
+    }
+    void glActiveTexture(GLenum texture) {
+        counts.binds++;
+        QOpenGLFunctions_3_3_Core::glActiveTexture(texture);
+        check("glActiveTexture");
+    }
+    void glBindVertexArray(GLuint array) {
+        counts.binds++;
+        QOpenGLFunctions_3_3_Core::glBindVertexArray(array);
+        check("glBindVertexArray");
+    }
+    void glBindFramebuffer(GLenum target, GLuint framebuffer) {
+        counts.binds++;
+        QOpenGLFunctions_3_3_Core::glBindFramebuffer(target, framebuffer);
+        check("glBindFramebuffer");
+    }
+    void glBindRenderbuffer(GLenum target, GLuint renderbuffer) {
+        counts.binds++;
+        QOpenGLFunctions_3_3_Core::glBindRenderbuffer(target, renderbuffer);
+        check("glBindRenderbuffer");
+    }
+    void glBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+        counts.binds++;
+        QOpenGLFunctions_3_3_Core::glBindBufferRange(target, index, buffer, offset, size);
+        check("glBindBufferRange");
+    }
+    void glUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding) {
+        counts.binds++;
+        QOpenGLFunctions_3_3_Core::glUniformBlockBinding(program, uniformBlockIndex, uniformBlockBinding);
+        check("glUniformBlockBinding");
+    }
+
+    void glUniform1i(GLint location, GLint v0) {
+        counts.uniforms++;
+        QOpenGLFunctions_3_3_Core::glUniform1i(location, v0);
+        check("glUniform1i");
+    }
+    void glUniform1f(GLint location, GLfloat v0) {
+        counts.uniforms++;
+        QOpenGLFunctions_3_3_Core::glUniform1f(location, v0);
+        check("glUniform1f");
+    }
+    void glUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+        counts.uniforms++;
+        QOpenGLFunctions_3_3_Core::glUniform3f(location, v0, v1, v2);
+        check("glUniform3f");
+    }
+    void glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+        counts.uniforms++;
+        QOpenGLFunctions_3_3_Core::glUniformMatrix4fv(location, count, transpose, value);
+        check("glUniformMatrix4fv");
+    }
+
+    void glBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+        counts.uploads++;
+        QOpenGLFunctions_3_3_Core::glBufferData(target, size, data, usage);
+        check("glBufferData");
+    }
+    void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+        counts.uploads++;
+        QOpenGLFunctions_3_3_Core::glBufferSubData(target, offset, size, data);
+        check("glBufferSubData");
+    }
+    void* glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+        counts.uploads++;
+        void* pointer = QOpenGLFunctions_3_3_Core::glMapBufferRange(target, offset, length, access);
+        check("glMapBufferRange");
+        return pointer;
+    }
+    void glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels) {
+        counts.uploads++;
+        QOpenGLFunctions_3_3_Core::glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+        check("glTexImage2D");
+    }
+    void glTexImage3D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void* pixels) {
+        counts.uploads++;
+        QOpenGLFunctions_3_3_Core::glTexImage3D(target, level, internalformat, width, height, depth, border, format, type, pixels);
+        check("glTexImage3D");
+    }
+    void glTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels) {
+        counts.uploads++;
+        QOpenGLFunctions_3_3_Core::glTexSubImage3D(target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels);
+        check("glTexSubImage3D");
+    }
+    GLboolean glUnmapBuffer(GLenum target) {
+        counts.uploads++;
+        GLboolean result = QOpenGLFunctions_3_3_Core::glUnmapBuffer(target);
+        check("glUnmapBuffer");
+        return result;
+    }
+    void glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) {
+        counts.uploads++;
+        QOpenGLFunctions_3_3_Core::glTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+        check("glTexSubImage2D");
+    }
+    void glGenerateMipmap(GLenum target) {
+        counts.uploads++;
+        QOpenGLFunctions_3_3_Core::glGenerateMipmap(target);
+        check("glGenerateMipmap");
+    }
+    void glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels) {
+        counts.uploads++;
+        QOpenGLFunctions_3_3_Core::glReadPixels(x, y, width, height, format, type, pixels);
+        check("glReadPixels");
+    }
+    void glGetBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, void* data) {
+        counts.uploads++;
+        QOpenGLFunctions_3_3_Core::glGetBufferSubData(target, offset, size, data);
+        check("glGetBufferSubData");
+    }
+
+    void glEnable(GLenum cap) {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glEnable(cap);
+        check("glEnable");
+    }
+    void glDisable(GLenum cap) {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glDisable(cap);
+        check("glDisable");
+    }
+    void glDepthFunc(GLenum func) {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glDepthFunc(func);
+        check("glDepthFunc");
+    }
+    void glDepthMask(GLboolean flag) {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glDepthMask(flag);
+        check("glDepthMask");
+    }
+    void glColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glColorMask(red, green, blue, alpha);
+        check("glColorMask");
+    }
+    void glStencilFunc(GLenum func, GLint ref, GLuint mask) {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glStencilFunc(func, ref, mask);
+        check("glStencilFunc");
+    }
+    void glStencilMask(GLuint mask) {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glStencilMask(mask);
+        check("glStencilMask");
+    }
+    void glStencilOp(GLenum fail, GLenum zfail, GLenum zpass) {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glStencilOp(fail, zfail, zpass);
+        check("glStencilOp");
+    }
+    void glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glClearColor(red, green, blue, alpha);
+        check("glClearColor");
+    }
+    void glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glViewport(x, y, width, height);
+        check("glViewport");
+    }
+    void glPixelStorei(GLenum pname, GLint param) {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glPixelStorei(pname, param);
+        check("glPixelStorei");
+    }
+    void glReadBuffer(GLenum src) {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glReadBuffer(src);
+        check("glReadBuffer");
+    }
+    void glBeginQuery(GLenum target, GLuint id) {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glBeginQuery(target, id);
+        check("glBeginQuery");
+    }
+    void glEndQuery(GLenum target) {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glEndQuery(target);
+        check("glEndQuery");
+    }
+    void glGetQueryObjectuiv(GLuint id, GLenum pname, GLuint* params) {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glGetQueryObjectuiv(id, pname, params);
+        check("glGetQueryObjectuiv");
+    }
+    void glBeginConditionalRender(GLuint id, GLenum mode) {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glBeginConditionalRender(id, mode);
+        check("glBeginConditionalRender");
+    }
+    void glEndConditionalRender() {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glEndConditionalRender();
+        check("glEndConditionalRender");
+    }
+    void glBeginTransformFeedback(GLenum primitiveMode) {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glBeginTransformFeedback(primitiveMode);
+        check("glBeginTransformFeedback");
+    }
+    void glEndTransformFeedback() {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glEndTransformFeedback();
+        check("glEndTransformFeedback");
+    }
+    GLsync glFenceSync(GLenum condition, GLbitfield flags) {
+        counts.state++;
+        GLsync sync = QOpenGLFunctions_3_3_Core::glFenceSync(condition, flags);
+        check("glFenceSync");
+        return sync;
+    }
+    GLenum glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+        counts.state++;
+        GLenum result = QOpenGLFunctions_3_3_Core::glClientWaitSync(sync, flags, timeout);
+        check("glClientWaitSync");
+        return result;
+    }
+    void glWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glWaitSync(sync, flags, timeout);
+        check("glWaitSync");
+    }
+    void glDeleteSync(GLsync sync) {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glDeleteSync(sync);
+        check("glDeleteSync");
+    }
+    void glFlush() {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glFlush();
+        check("glFlush");
+    }
+    void glFinish() {
+        counts.state++;
+        QOpenGLFunctions_3_3_Core::glFinish();
+        check("glFinish");
+    }
+
+    void glGenBuffers(GLsizei n, GLuint* buffers) {
+        QOpenGLFunctions_3_3_Core::glGenBuffers(n, buffers);
+        check("glGenBuffers");
+    }
+    void glGenTextures(GLsizei n, GLuint* textures) {
+        QOpenGLFunctions_3_3_Core::glGenTextures(n, textures);
+        check("glGenTextures");
+    }
+    void glGenRenderbuffers(GLsizei n, GLuint* renderbuffers) {
+        QOpenGLFunctions_3_3_Core::glGenRenderbuffers(n, renderbuffers);
+        check("glGenRenderbuffers");
+    }
+    void glGenFramebuffers(GLsizei n, GLuint* framebuffers) {
+        QOpenGLFunctions_3_3_Core::glGenFramebuffers(n, framebuffers);
+        check("glGenFramebuffers");
+    }
+    void glGenVertexArrays(GLsizei n, GLuint* arrays) {
+        QOpenGLFunctions_3_3_Core::glGenVertexArrays(n, arrays);
+        check("glGenVertexArrays");
+    }
+    void glGenQueries(GLsizei n, GLuint* ids) {
+        QOpenGLFunctions_3_3_Core::glGenQueries(n, ids);
+        check("glGenQueries");
+    }
+    void glTexParameteri(GLenum target, GLenum pname, GLint param) {
+        QOpenGLFunctions_3_3_Core::glTexParameteri(target, pname, param);
+        check("glTexParameteri");
+    }
+    void glRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height) {
+        QOpenGLFunctions_3_3_Core::glRenderbufferStorage(target, internalformat, width, height);
+        check("glRenderbufferStorage");
+    }
+    void glFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer) {
+        QOpenGLFunctions_3_3_Core::glFramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+        check("glFramebufferRenderbuffer");
+    }
+    void glFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) {
+        QOpenGLFunctions_3_3_Core::glFramebufferTexture2D(target, attachment, textarget, texture, level);
+        check("glFramebufferTexture2D");
+    }
+    GLenum glCheckFramebufferStatus(GLenum target) {
+        GLenum result = QOpenGLFunctions_3_3_Core::glCheckFramebufferStatus(target);
+        check("glCheckFramebufferStatus");
+        return result;
+    }
+    void glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) {
+        QOpenGLFunctions_3_3_Core::glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+        check("glVertexAttribPointer");
+    }
+    void glEnableVertexAttribArray(GLuint index) {
+        QOpenGLFunctions_3_3_Core::glEnableVertexAttribArray(index);
+        check("glEnableVertexAttribArray");
+    }
+    void glVertexAttribDivisor(GLuint index, GLuint divisor) {
+        QOpenGLFunctions_3_3_Core::glVertexAttribDivisor(index, divisor);
+        check("glVertexAttribDivisor");
+    }
+    void glTransformFeedbackVaryings(GLuint program, GLsizei count, const GLchar* const* varyings, GLenum bufferMode) {
+        QOpenGLFunctions_3_3_Core::glTransformFeedbackVaryings(program, count, varyings, bufferMode);
+        check("glTransformFeedbackVaryings");
+    }
+    GLuint glGetUniformBlockIndex(GLuint program, const GLchar* uniformBlockName) {
+        GLuint result = QOpenGLFunctions_3_3_Core::glGetUniformBlockIndex(program, uniformBlockName);
+        check("glGetUniformBlockIndex");
+        return result;
+    }
+    void glGetIntegerv(GLenum pname, GLint* data) {
+        QOpenGLFunctions_3_3_Core::glGetIntegerv(pname, data);
+        check("glGetIntegerv");
+    }
+
+private:
+    void check(const char* call);
+
+    GLCallCounts counts;
+    bool checkErrors = true;
+};
+
+using GLFunctions = TracedGLFunctions;
+
+#else
+
+// 默认构建直接使用 Qt 的函数表，没有任何额外开销
+using GLFunctions = QOpenGLFunctions_3_3_Core;
+
+#endif
+
+
+#endif // GLFUNCTIONS_H
@@ -0,0 +1,57 @@
+#include "GLResource.h"
+
+std::atomic<int> GLResourceRegistry::counts[int(GLObjectType::Count)] = {};
+std::atomic<qint64> GLResourceRegistry::bytes[int(GLObjectType::Count)] = {};
+
+namespace {
+
+const char* const typeNames[] = {
+    "buffers",
+    "textures",
+    "renderbuffers",
+    "framebuffers",
+    "vertex arrays",
+    "queries",
+    "programs"
+};
+
+}
+
+void GLResourceRegistry::created(GLObjectType type) {
+    counts[int(type)]++;
+}
+
+void GLResourceRegistry::destroyed(GLObjectType type, qint64 size) {
+    counts[int(type)]--;
+    bytes[int(type)] -= size;
+}
+
+void GLResourceRegistry::resized(GLObjectType type, qint64 oldBytes, qint64 newBytes) {
+    bytes[int(type)] += newBytes - oldBytes;
+}
+
+qint64 GLResourceRegistry::totalBytes() {
+    qint64 total = 0;
+    for (const std::atomic<qint64>& size : bytes) {
+        total += size;
+    }
+    return total;
+}
+
+QString GLResourceRegistry::report() {
+    QString message = "gl objects:";
+    for (int i = 0; i < int(GLObjectType::Count); i++) {
+        message += QString(" %1 %2").arg(typeNames[i]).arg(int(counts[i]));
+        if (bytes[i] > 0) {
+            message += QString(" (%1 KB)").arg(bytes[i] / 1024);
+        }
+        message += i + 1 < int(GLObjectType::Count) ? "," : ";";
+    }
+    message += QString(" total %1 KB").arg(totalBytes() / 1024);
+    return message;
+}
+
+qint64 GLResourceRegistry::imageBytes(int width, int height, int layers, bool mipmaps) {
+    qint64 size = qint64(width) * height * layers * 4;
+    return mipmaps ? size * 4 / 3 : size;
+}
@@ -0,0 +1,141 @@
+#ifndef GLRESOURCE_H
+#define GLRESOURCE_H
+
+
+#include <QDebug>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QString>
+#include <atomic>
+#include "GLFunctions.h"
+
+enum class GLObjectType {
+    Buffer,
+    Texture,
+    Renderbuffer,
+    Framebuffer,
+    VertexArray,
+    Query,
+    Program,
+    Count
+};
+
+// 全局的 GL 对象登记：各类对象的存活数与估计显存，句柄创建、释放和分配存储时更新
+// 计数为原子量，渲染线程与界面线程可同时更新
+class GLResourceRegistry {
+public:
+    static void created(GLObjectType type);
+    static void destroyed(GLObjectType type, qint64 bytes);
+    static void resized(GLObjectType type, qint64 oldBytes, qint64 newBytes);
+
+    static int liveCount(GLObjectType type) { return counts[int(type)]; }
+    static qint64 liveBytes(GLObjectType type) { return bytes[int(type)]; }
+    static qint64 totalBytes();
+    // 一行报告：逐类型的存活数与显存，以及合计
+    static QString report();
+
+    // 按每像素 4 字节估计纹理和渲染缓冲的大小，完整 mipmap 链多出约三分之一
+    static qint64 imageBytes(int width, int height, int layers = 1, bool mipmaps = false);
+
+private:
+    static std::atomic<int> counts[int(GLObjectType::Count)];
+    static std::atomic<qint64> bytes[int(GLObjectType::Count)];
+};
+
+// 只可移动的 GL 对象句柄：析构或 reset() 时删除对象并从登记中注销
+// 删除时需有对象所在共享组（VAO、帧缓冲、查询为创建它的上下文）的当前上下文，
+// 没有当前上下文时对象泄漏，登记中的计数不减，便于发现
+template <GLObjectType Type>
+class GLHandle {
+public:
+    GLHandle() = default;
+    ~GLHandle() { reset(); }
+
+    GLHandle(const GLHandle&) = delete;
+    GLHandle& operator=(const GLHandle&) = delete;
+    GLHandle(GLHandle&& other) noexcept : name(other.name), size(other.size) {
+        other.name = 0;
+        other.size = 0;
+    }
+    GLHandle& operator=(GLHandle&& other) noexcept {
+        if (this != &other) {
+            reset();
+            name = other.name;
+            size = other.size;
+            other.name = 0;
+            other.size = 0;
+        }
+        return *this;
+    }
+
+    // 创建新对象，已持有的对象先删除
+    void create(GLFunctions* functions) {
+        reset();
+        if constexpr (Type == GLObjectType::Buffer) {
+            functions->glGenBuffers(1, &name);
+        } else if constexpr (Type == GLObjectType::Texture) {
+            functions->glGenTextures(1, &name);
+        } else if constexpr (Type == GLObjectType::Renderbuffer) {
+            functions->glGenRenderbuffers(1, &name);
+        } else if constexpr (Type == GLObjectType::Framebuffer) {
+            functions->glGenFramebuffers(1, &name);
+        } else if constexpr (Type == GLObjectType::VertexArray) {
+            functions->glGenVertexArrays(1, &name);
+        } else if constexpr (Type == GLObjectType::Query) {
+            functions->glGenQueries(1, &name);
+        }
+        GLResourceRegistry::created(Type);
+    }
+
+    void reset() {
+        if (!name) {
+            return;
+        }
+        QOpenGLContext* context = QOpenGLContext::currentContext();
+        if (!context) {
+            qDebug() << "GLHandle released without a current context, object leaked!";
+            return;
+        }
+        QOpenGLExtraFunctions* functions = context->extraFunctions();
+        if constexpr (Type == GLObjectType::Buffer) {
+            functions->glDeleteBuffers(1, &name);
+        } else if constexpr (Type == GLObjectType::Texture) {
+            functions->glDeleteTextures(1, &name);
+        } else if constexpr (Type == GLObjectType::Renderbuffer) {
+            functions->glDeleteRenderbuffers(1, &name);
+        } else if constexpr (Type == GLObjectType::Framebuffer) {
+            functions->glDeleteFramebuffers(1, &name);
+        } else if constexpr (Type == GLObjectType::VertexArray) {
+            functions->glDeleteVertexArrays(1, &name);
+        } else if constexpr (Type == GLObjectType::Query) {
+            functions->glDeleteQueries(1, &name);
+        }
+        GLResourceRegistry::destroyed(Type, size);
+        name = 0;
+        size = 0;
+    }
+
+    // 分配或重新分配存储后登记估计的显存，如 glBufferData、glTexImage2D 之后
+    void setBytes(qint64 newSize) {
+        GLResourceRegistry::resized(Type, size, newSize);
+        size = newSize;
+    }
+
+    GLuint id() const { return name; }
+    operator GLuint() const { return name; }
+    qint64 bytes() const { return size; }
+
+private:
+    GLuint name = 0;
+    qint64 size = 0;
+};
+
+using GLBuffer = GLHandle<GLObjectType::Buffer>;
+using GLTexture = GLHandle<GLObjectType::Texture>;
+using GLRenderbuffer = GLHandle<GLObjectType::Renderbuffer>;
+using GLFramebuffer = GLHandle<GLObjectType::Framebuffer>;
+using GLVertexArray = GLHandle<GLObjectType::VertexArray>;
+using GLQuery = GLHandle<GLObjectType::Query>;
+
+
+#endif // GLRESOURCE_H
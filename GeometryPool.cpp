@@ -0,0 +1,380 @@
+#include "GeometryPool.h"
+#include <QDebug>
+#include <QFloat16>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+namespace {
+
+struct AttributeSpec {
+    GLuint location;
+    int components;
+    AttributeType type;
+};
+
+}
+
+// 属性按给出的顺序存放，每个属性打包后补齐到 4 字节
+static VertexLayout makeLayout(std::initializer_list<AttributeSpec> attributes) {
+    VertexLayout layout;
+    for (const AttributeSpec& attribute : attributes) {
+        VertexAttribute& target = layout.attributes[layout.attributeCount];
+        target.location = attribute.location;
+        target.components = attribute.components;
+        target.type = attribute.type;
+        target.offset = layout.stride;
+
+        int bytes = 0;
+        switch (target.type) {
+            case AttributeType::Float:
+                bytes = target.components * 4;
+                break;
+            case AttributeType::Half:
+            case AttributeType::Snorm16:
+                bytes = target.components * 2;
+                break;
+            case AttributeType::Unorm8:
+                bytes = target.components;
+                break;
+        }
+        layout.stride += (bytes + 3) & ~3;
+        layout.attributeCount++;
+    }
+    return layout;
+}
+
+const VertexLayout& GeometryPool::layout(VertexFormat format) {
+    // 天空盒与屏幕平面的坐标只有 ±1，用归一化短整数；单位立方体坐标 ±0.5 与纹理坐标用半精度即可精确表示；
+    // 静态立方体的位置已烘焙为世界坐标，保留 float；颜色统一用归一化字节；纹理网格不带颜色，每顶点 12 字节
+    static const VertexLayout layouts[] = {
+        makeLayout({ { 0, 3, AttributeType::Snorm16 } }),
+        makeLayout({ { 0, 3, AttributeType::Float }, { 1, 3, AttributeType::Unorm8 } }),
+        makeLayout({ { 0, 3, AttributeType::Half }, { 2, 2, AttributeType::Half } }),
+        makeLayout({ { 0, 2, AttributeType::Snorm16 }, { 1, 2, AttributeType::Half } }),
+        VertexLayout()
+    };
+    return layouts[int(format)];
+}
+
+int GeometryPool::floatsPerVertex(VertexFormat format) {
+    const VertexLayout& vertexLayout = layout(format);
+    int floats = 0;
+    for (int i = 0; i < vertexLayout.attributeCount; i++) {
+        floats += vertexLayout.attributes[i].components;
+    }
+    return floats;
+}
+
+void GeometryPool::pack(const VertexLayout& layout, const float* source, unsigned char* target) {
+    for (int i = 0; i < layout.attributeCount; i++) {
+        const VertexAttribute& attribute = layout.attributes[i];
+        unsigned char* out = target + attribute.offset;
+        for (int c = 0; c < attribute.components; c++) {
+            float value = *source++;
+            switch (attribute.type) {
+                case AttributeType::Float:
+                    memcpy(out + c * 4, &value, 4);
+                    break;
+                case AttributeType::Half: {
+                    qfloat16 half(value);
+                    memcpy(out + c * 2, &half, 2);
+                    break;
+                }
+                case AttributeType::Snorm16: {
+                    // -1 取 -32768、1 取 32767，在 GL 4.2 前后两种换算规则下都精确
+                    qint16 packed = value >= 1.0f ? 32767 : value <= -1.0f ? -32768 : qint16(qRound(value * 32767.0f));
+                    memcpy(out + c * 2, &packed, 2);
+                    break;
+                }
+                case AttributeType::Unorm8:
+                    out[c] = quint8(qRound(std::min(std::max(value, 0.0f), 1.0f) * 255.0f));
+                    break;
+            }
+        }
+    }
+}
+
+void GeometryPool::init(GLFunctions* functions) {
+    gl = functions;
+}
+
+void GeometryPool::destroy() {
+    if (!gl) {
+        return;
+    }
+    for (Arena& arena : arenas) {
+        arena = Arena();
+    }
+}
+
+MeshRange GeometryPool::add(VertexFormat format, const float* vertices, int vertexCount, const GLuint* indices, int indexCount) {
+    Arena& arena = arenas[int(format)];
+    if (arena.vbo) {
+        qDebug() << "GeometryPool::add called after upload!";
+    }
+
+    MeshRange mesh;
+    mesh.format = format;
+    mesh.baseVertex = arena.vertexCount;
+    mesh.firstIndex = GLsizei(arena.indices.size());
+    mesh.indexCount = indexCount;
+
+    // 源数据在追加时即按布局打包
+    const VertexLayout& vertexLayout = layout(format);
+    int floats = floatsPerVertex(format);
+    size_t offset = arena.vertices.size();
+    arena.vertices.resize(offset + size_t(vertexCount) * vertexLayout.stride);
+    for (int i = 0; i < vertexCount; i++) {
+        pack(vertexLayout, vertices + i * floats, arena.vertices.data() + offset + size_t(i) * vertexLayout.stride);
+    }
+
+    arena.indices.insert(arena.indices.end(), indices, indices + indexCount);
+    for (int i = 0; i < indexCount; i++) {
+        arena.maxIndex = std::max(arena.maxIndex, indices[i]);
+    }
+    arena.vertexCount += vertexCount;
+    return mesh;
+}
+
+void GeometryPool::upload() {
+    for (int i = 0; i < int(VertexFormat::Count); i++) {
+        Arena& arena = arenas[i];
+        if (arena.vertexCount == 0 || arena.vbo) {
+            continue;
+        }
+
+        arena.vbo.create(gl);
+        arena.ebo.create(gl);
+
+        gl->glBindBuffer(GL_ARRAY_BUFFER, arena.vbo);
+        gl->glBufferData(GL_ARRAY_BUFFER, arena.vertices.size(), arena.vertices.data(), GL_STATIC_DRAW);
+        arena.vbo.setBytes(qint64(arena.vertices.size()));
+        gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // 索引相对于各自网格的第一个顶点，只要网格内不超过 65535 即可用 16 位索引
+        arena.indexType = arena.maxIndex <= 0xFFFF ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        std::vector<GLushort> shortIndices;
+        const void* indexData = arena.indices.data();
+        if (arena.indexType == GL_UNSIGNED_SHORT) {
+            shortIndices.assign(arena.indices.begin(), arena.indices.end());
+            indexData = shortIndices.data();
+        }
+        // 不绑定 VAO 时绑定 EBO 会改动当前 VAO 的状态，这里借用 COPY_WRITE 目标上传
+        gl->glBindBuffer(GL_COPY_WRITE_BUFFER, arena.ebo);
+        gl->glBufferData(GL_COPY_WRITE_BUFFER, arena.indices.size() * indexSize(arena.indexType), indexData, GL_STATIC_DRAW);
+        arena.ebo.setBytes(qint64(arena.indices.size()) * indexSize(arena.indexType));
+        gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+}
+
+void GeometryPool::setupAttributes(GLFunctions* gl, VertexFormat format) {
+    const VertexLayout& vertexLayout = layout(format);
+    for (int i = 0; i < vertexLayout.attributeCount; i++) {
+        const VertexAttribute& attribute = vertexLayout.attributes[i];
+        GLenum type = GL_FLOAT;
+        GLboolean normalized = GL_FALSE;
+        switch (attribute.type) {
+            case AttributeType::Float:
+                break;
+            case AttributeType::Half:
+                type = GL_HALF_FLOAT;
+                break;
+            case AttributeType::Snorm16:
+                type = GL_SHORT;
+                normalized = GL_TRUE;
+                break;
+            case AttributeType::Unorm8:
+                type = GL_UNSIGNED_BYTE;
+                normalized = GL_TRUE;
+                break;
+        }
+        gl->glVertexAttribPointer(attribute.location, attribute.components, type, normalized, vertexLayout.stride, (void*)(intptr_t)attribute.offset);
+        gl->glEnableVertexAttribArray(attribute.location);
+    }
+}
+
+void VertexArrays::init(GLFunctions* functions, const GeometryPool& pool) {
+    gl = functions;
+    for (int i = 0; i < int(VertexFormat::Count); i++) {
+        VertexFormat format = VertexFormat(i);
+        if (!pool.vertexBuffer(format) || vaos[i]) {
+            continue;
+        }
+
+        indexTypes[i] = pool.indexType(format);
+        vaos[i].create(gl);
+        gl->glBindVertexArray(vaos[i]);
+        gl->glBindBuffer(GL_ARRAY_BUFFER, pool.vertexBuffer(format));
+        gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.indexBuffer(format));
+        GeometryPool::setupAttributes(gl, format);
+        gl->glBindVertexArray(0);
+        gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    boundFormat = VertexFormat::Count;
+}
+
+void VertexArrays::destroy() {
+    if (!gl) {
+        return;
+    }
+    for (GLVertexArray& vao : vaos) {
+        vao.reset();
+    }
+    extraVaos.clear();
+    boundFormat = VertexFormat::Count;
+}
+
+GLuint VertexArrays::addInstanced(const GeometryPool& pool, VertexFormat format, GLuint instanceBuffer, int instanceStride, int layerOffset,
+                                  int firstInstance) {
+    if (!pool.vertexBuffer(format) || !instanceBuffer) {
+        return 0;
+    }
+
+    extraVaos.emplace_back();
+    GLVertexArray& vao = extraVaos.back();
+    vao.create(gl);
+    gl->glBindVertexArray(vao);
+    gl->glBindBuffer(GL_ARRAY_BUFFER, pool.vertexBuffer(format));
+    gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.indexBuffer(format));
+    GeometryPool::setupAttributes(gl, format);
+
+    GLsizei stride = instanceStride * sizeof(float);
+    size_t base = size_t(firstInstance) * stride;
+    gl->glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    gl->glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, stride, (void*)base);
+    gl->glEnableVertexAttribArray(3);
+    gl->glVertexAttribDivisor(3, 1);
+    gl->glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, stride, (void*)(base + layerOffset * sizeof(float)));
+    gl->glEnableVertexAttribArray(4);
+    gl->glVertexAttribDivisor(4, 1);
+
+    gl->glBindVertexArray(0);
+    gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
+    boundFormat = VertexFormat::Count;
+    return vao;
+}
+
+GLuint VertexArrays::addStateArray(GLuint buffer, int vec4Count) {
+    if (!buffer) {
+        return 0;
+    }
+
+    extraVaos.emplace_back();
+    GLVertexArray& vao = extraVaos.back();
+    vao.create(gl);
+    gl->glBindVertexArray(vao);
+    gl->glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    GLsizei stride = vec4Count * 4 * sizeof(float);
+    for (int i = 0; i < vec4Count; i++) {
+        gl->glVertexAttribPointer(i, 4, GL_FLOAT, GL_FALSE, stride, (void*)(i * 4 * sizeof(float)));
+        gl->glEnableVertexAttribArray(i);
+    }
+    gl->glBindVertexArray(0);
+    gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
+    boundFormat = VertexFormat::Count;
+    return vao;
+}
+
+void VertexArrays::drawInstanced(GLuint vao, const MeshRange& mesh, int instanceCount) {
+    if (!vao || instanceCount <= 0) {
+        return;
+    }
+    gl->glBindVertexArray(vao);
+    boundFormat = VertexFormat::Count;
+    GLenum type = indexTypes[int(mesh.format)];
+    gl->glDrawElementsInstancedBaseVertex(GL_TRIANGLES, mesh.indexCount, type,
+                                          (void*)(intptr_t)(mesh.firstIndex * GeometryPool::indexSize(type)), instanceCount, mesh.baseVertex);
+}
+
+void VertexArrays::bind(VertexFormat format) {
+    if (boundFormat == format) {
+        return;
+    }
+    gl->glBindVertexArray(vaos[int(format)]);
+    boundFormat = format;
+}
+
+void VertexArrays::unbind() {
+    gl->glBindVertexArray(0);
+    boundFormat = VertexFormat::Count;
+}
+
+void VertexArrays::draw(const MeshRange& mesh) {
+    bind(mesh.format);
+    GLenum type = indexTypes[int(mesh.format)];
+    gl->glDrawElementsBaseVertex(GL_TRIANGLES, mesh.indexCount, type,
+                                 (void*)(intptr_t)(mesh.firstIndex * GeometryPool::indexSize(type)), mesh.baseVertex);
+}
+
+void VertexArrays::multiDraw(const std::vector<MeshRange>& meshes) {
+    if (meshes.empty()) {
+        return;
+    }
+
+    GLenum type = indexTypes[int(meshes.front().format)];
+    drawCounts.clear();
+    drawOffsets.clear();
+    drawBaseVertices.clear();
+    for (const MeshRange& mesh : meshes) {
+        if (mesh.format != meshes.front().format) {
+            qDebug() << "VertexArrays::multiDraw requires meshes of a single vertex format!";
+            continue;
+        }
+        drawCounts.push_back(mesh.indexCount);
+        drawOffsets.push_back((const void*)(intptr_t)(mesh.firstIndex * GeometryPool::indexSize(type)));
+        drawBaseVertices.push_back(mesh.baseVertex);
+    }
+
+    bind(meshes.front().format);
+    gl->glMultiDrawElementsBaseVertex(GL_TRIANGLES, drawCounts.data(), type,
+                                      drawOffsets.data(), GLsizei(drawCounts.size()), drawBaseVertices.data());
+}
+
+GLsizeiptr GeometryPool::vertexBytes() const {
+    GLsizeiptr bytes = 0;
+    for (const Arena& arena : arenas) {
+        bytes += arena.vertices.size();
+    }
+    return bytes;
+}
+
+GLsizeiptr GeometryPool::indexBytes() const {
+    GLsizeiptr bytes = 0;
+    for (const Arena& arena : arenas) {
+        bytes += arena.indices.size() * indexSize(arena.indexType);
+    }
+    return bytes;
+}
+
+QString GeometryPool::report() const {
+    static const char* names[] = { "Pos3", "Pos3Color3", "Pos3Tex2", "Pos2Tex2" };
+    QString message("geometry bytes:");
+    GLsizeiptr packedTotal = 0, floatTotal = 0;
+    for (int i = 0; i < int(VertexFormat::Count); i++) {
+        const Arena& arena = arenas[i];
+        if (arena.vertexCount == 0) {
+            continue;
+        }
+        VertexFormat format = VertexFormat(i);
+        GLsizeiptr packed = GLsizeiptr(arena.vertices.size() + arena.indices.size() * indexSize(arena.indexType));
+        GLsizeiptr unpacked = GLsizeiptr(arena.vertexCount) * floatsPerVertex(format) * sizeof(float) + arena.indices.size() * sizeof(GLuint);
+        message += QString("\n  %1: %2 vertices x %3 B (float %4 B), %5 indices x %6 B, %7 B (float %8 B)")
+                       .arg(names[i])
+                       .arg(arena.vertexCount)
+                       .arg(layout(format).stride)
+                       .arg(floatsPerVertex(format) * int(sizeof(float)))
+                       .arg(arena.indices.size())
+                       .arg(indexSize(arena.indexType))
+                       .arg(packed)
+                       .arg(unpacked);
+        packedTotal += packed;
+        floatTotal += unpacked;
+    }
+    message += QString("\n  total %1 B (float %2 B, %3% saved)")
+                   .arg(packedTotal)
+                   .arg(floatTotal)
+                   .arg(floatTotal > 0 ? 100.0 * (floatTotal - packedTotal) / floatTotal : 0.0, 0, 'f', 1);
+    return message;
+}
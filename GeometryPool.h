@@ -0,0 +1,127 @@
+#ifndef GEOMETRYPOOL_H
+#define GEOMETRYPOOL_H
+
+
+#include <QString>
+#include <vector>
+#include "GLFunctions.h"
+#include "GLResource.h"
+
+// 顶点格式：同一格式的网格共享一个大 VBO 和一个大 EBO，每个上下文各一个 VAO
+// 名称描述的是 add() 接收的 float 源数据，VBO 中按 VertexLayout 打包存放
+enum class VertexFormat {
+    Pos3,           // 天空盒：位置
+    Pos3Color3,     // 纯色立方体：位置 + 颜色
+    Pos3Tex2,       // 纹理网格：位置 + 纹理坐标，纹理着色器不读顶点颜色
+    Pos2Tex2,       // 屏幕平面：位置 + 纹理坐标
+    Count
+};
+
+// 顶点属性在 VBO 中的存储类型
+enum class AttributeType {
+    Float,      // 32 位浮点
+    Half,       // 16 位浮点
+    Snorm16,    // 有符号归一化短整数，源数据须在 [-1, 1] 内
+    Unorm8      // 无符号归一化字节，源数据须在 [0, 1] 内
+};
+
+struct VertexAttribute {
+    GLuint location = 0;    // 与着色器中的 location 一致，纹理坐标总在 2
+    int components = 0;     // 源数据中的 float 个数
+    AttributeType type = AttributeType::Float;
+    int offset = 0;         // 打包后在顶点内的字节偏移，按 4 字节对齐
+};
+
+struct VertexLayout {
+    VertexAttribute attributes[3];
+    int attributeCount = 0;
+    GLsizei stride = 0;
+};
+
+// 几何池中的一段子分配，绘制时通过 baseVertex 偏移定位顶点
+struct MeshRange {
+    VertexFormat format = VertexFormat::Pos3;
+    GLint baseVertex = 0;
+    GLsizei firstIndex = 0;
+    GLsizei indexCount = 0;
+};
+
+class GeometryPool {
+public:
+    void init(GLFunctions* functions);
+    void destroy();
+
+    // 追加一个网格，索引相对于网格自身的第一个顶点
+    MeshRange add(VertexFormat format, const float* vertices, int vertexCount, const GLuint* indices, int indexCount);
+    // 每种格式一次性分配并上传 VBO/EBO
+    void upload();
+
+    GLuint vertexBuffer(VertexFormat format) const { return arenas[int(format)].vbo; }
+    GLuint indexBuffer(VertexFormat format) const { return arenas[int(format)].ebo; }
+
+    // 网格内最大索引不超过 65535 的格式使用 GL_UNSIGNED_SHORT，上传后才确定
+    GLenum indexType(VertexFormat format) const { return arenas[int(format)].indexType; }
+
+    GLsizeiptr vertexBytes() const;
+    GLsizeiptr indexBytes() const;
+    // 逐格式列出打包后与全 float / 32 位索引时的字节数
+    QString report() const;
+
+    static int floatsPerVertex(VertexFormat format);
+    static const VertexLayout& layout(VertexFormat format);
+    static void setupAttributes(GLFunctions* gl, VertexFormat format);
+    static GLsizei indexSize(GLenum type) { return type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint); }
+
+private:
+    struct Arena {
+        std::vector<unsigned char> vertices;
+        std::vector<GLuint> indices;
+        GLBuffer vbo, ebo;
+        int vertexCount = 0;
+        GLuint maxIndex = 0;
+        GLenum indexType = GL_UNSIGNED_INT;
+    };
+
+    static void pack(const VertexLayout& layout, const float* source, unsigned char* target);
+
+    GLFunctions* gl = nullptr;
+    Arena arenas[int(VertexFormat::Count)];
+};
+
+// 每个 GL 上下文各自的 VAO：缓冲对象可在共享上下文间共享，VAO 不行
+class VertexArrays {
+public:
+    void init(GLFunctions* functions, const GeometryPool& pool);
+    void destroy();
+
+    void bind(VertexFormat format);
+    void unbind();
+    void draw(const MeshRange& mesh);
+    // 同一格式的多个网格合并为一次 glMultiDrawElementsBaseVertex
+    void multiDraw(const std::vector<MeshRange>& meshes);
+
+    // 实例化 VAO：在 format 的顶点属性之外，从 instanceBuffer 逐实例读取
+    // location 3 的 vec4（位置 + 边长）和 location 4 的 float（纹理层），偏移和步长以 float 计
+    // firstInstance 为实例数据在缓冲中的起点，GL 3.3 没有 baseInstance，缓冲中的每一段各用一个 VAO
+    GLuint addInstanced(const GeometryPool& pool, VertexFormat format, GLuint instanceBuffer, int instanceStride, int layerOffset,
+                        int firstInstance = 0);
+    // 状态 VAO：buffer 中每个元素为 vec4Count 个 vec4，依次绑定到 location 0、1 ...
+    GLuint addStateArray(GLuint buffer, int vec4Count);
+    void drawInstanced(GLuint vao, const MeshRange& mesh, int instanceCount);
+
+    static const int FLOATS_PER_INSTANCE = 5;
+
+private:
+    GLFunctions* gl = nullptr;
+    GLVertexArray vaos[int(VertexFormat::Count)];
+    GLenum indexTypes[int(VertexFormat::Count)] = {};
+    std::vector<GLVertexArray> extraVaos;
+    VertexFormat boundFormat = VertexFormat::Count;
+
+    std::vector<GLsizei> drawCounts;
+    std::vector<const void*> drawOffsets;
+    std::vector<GLint> drawBaseVertices;
+};
+
+
+#endif // GEOMETRYPOOL_H
@@ -0,0 +1,218 @@
+#include "InputRecorder.h"
+#include <QDebug>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+
+static const quint32 RECORDING_MAGIC = 0x4F474C52; // "OGLR"
+static const quint16 RECORDING_VERSION = 2;
+
+bool InputRecorder::startRecording(const QString& path, const QByteArray& config) {
+    stop();
+    file.setFileName(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "Failed to open recording file!" << path;
+        return false;
+    }
+
+    stream.setDevice(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    stream << RECORDING_MAGIC << RECORDING_VERSION << config;
+
+    recordedConfig = config;
+    pendingEvents.clear();
+    recording = true;
+    return true;
+}
+
+bool InputRecorder::loadReplay(const QString& path) {
+    stop();
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Failed to open replay file!" << path;
+        return false;
+    }
+
+    stream.setDevice(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    stream >> magic >> version;
+    if (magic != RECORDING_MAGIC || version != RECORDING_VERSION) {
+        qDebug() << "Replay file has unknown format!" << path;
+        file.close();
+        return false;
+    }
+    stream >> recordedConfig;
+
+    frames.clear();
+    while (!stream.atEnd()) {
+        RecordedFrame frame;
+        quint16 eventCount = 0;
+        stream >> frame.deltaTime >> eventCount;
+        for (quint16 i = 0; i < eventCount; i++) {
+            quint8 type = 0;
+            stream >> type;
+            InputEvent event;
+            event.type = InputEventType(type);
+            if (event.type == InputEventType::KeyPress || event.type == InputEventType::KeyRelease) {
+                stream >> event.a;
+            } else if (event.type == InputEventType::Projection) {
+                quint8 perspective = 0;
+                stream >> perspective;
+                event.a = perspective;
+            } else {
+                qint16 x = 0, y = 0;
+                stream >> x >> y;
+                event.a = x;
+                event.b = y;
+            }
+            frame.events.push_back(event);
+        }
+        if (stream.status() != QDataStream::Ok) {
+            qDebug() << "Replay file is truncated at frame" << frames.size();
+            break;
+        }
+        frames.push_back(frame);
+    }
+    file.close();
+
+    replayIndex = 0;
+    replaying = true;
+    return true;
+}
+
+void InputRecorder::stop() {
+    if (recording) {
+        file.flush();
+    }
+    if (file.isOpen()) {
+        file.close();
+    }
+    recording = false;
+    replaying = false;
+}
+
+void InputRecorder::record(const InputEvent& event) {
+    if (recording) {
+        pendingEvents.push_back(event);
+    }
+}
+
+void InputRecorder::recordFrame(float deltaTime) {
+    if (!recording) {
+        return;
+    }
+
+    stream << deltaTime << quint16(pendingEvents.size());
+    for (const InputEvent& event : pendingEvents) {
+        stream << quint8(event.type);
+        if (event.type == InputEventType::KeyPress || event.type == InputEventType::KeyRelease) {
+            stream << event.a;
+        } else if (event.type == InputEventType::Projection) {
+            stream << quint8(event.a);
+        } else {
+            stream << qint16(event.a) << qint16(event.b);
+        }
+    }
+    pendingEvents.clear();
+}
+
+bool InputRecorder::nextFrame(RecordedFrame& frame) {
+    if (!replaying || replayIndex >= int(frames.size())) {
+        return false;
+    }
+    frame = frames[replayIndex++];
+    return true;
+}
+
+namespace FrameTimings {
+
+bool save(const QString& path, const std::vector<float>& milliseconds) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        qDebug() << "Failed to open timings file!" << path;
+        return false;
+    }
+    QTextStream out(&file);
+    out << "frame,ms\n";
+    for (size_t i = 0; i < milliseconds.size(); i++) {
+        out << i << "," << milliseconds[i] << "\n";
+    }
+    return true;
+}
+
+bool load(const QString& path, std::vector<float>& milliseconds) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qDebug() << "Failed to open baseline file!" << path;
+        return false;
+    }
+    milliseconds.clear();
+    file.readLine(); // 表头
+    while (!file.atEnd()) {
+        QList<QByteArray> fields = file.readLine().trimmed().split(',');
+        if (fields.size() == 2) {
+            milliseconds.push_back(fields[1].toFloat());
+        }
+    }
+    return true;
+}
+
+static float percentile(std::vector<float> values, float p) {
+    if (values.empty()) {
+        return 0.0f;
+    }
+    size_t index = std::min(values.size() - 1, size_t(p * (values.size() - 1) + 0.5f));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+QString compare(const std::vector<float>& baseline, const std::vector<float>& current) {
+    size_t count = std::min(baseline.size(), current.size());
+    if (count == 0) {
+        return QString("no frames to compare");
+    }
+
+    std::vector<float> base(baseline.begin(), baseline.begin() + count);
+    std::vector<float> cur(current.begin(), current.begin() + count);
+    double baseSum = 0.0, curSum = 0.0;
+    int slower = 0;
+    size_t worstFrame = 0;
+    float worstDelta = -INFINITY;
+    for (size_t i = 0; i < count; i++) {
+        baseSum += base[i];
+        curSum += cur[i];
+        float delta = cur[i] - base[i];
+        if (cur[i] > base[i] * 1.1f) {
+            slower++;
+        }
+        if (delta > worstDelta) {
+            worstDelta = delta;
+            worstFrame = i;
+        }
+    }
+
+    QString report = QString("replay %1 frames: mean %2 ms (baseline %3 ms, %4%), p95 %5 ms (baseline %6 ms), "
+                             "%7 frames >10% slower, worst frame %8 (+%9 ms)")
+                         .arg(count)
+                         .arg(curSum / count, 0, 'f', 3)
+                         .arg(baseSum / count, 0, 'f', 3)
+                         .arg(baseSum > 0.0 ? (curSum - baseSum) / baseSum * 100.0 : 0.0, 0, 'f', 1)
+                         .arg(percentile(cur, 0.95f), 0, 'f', 3)
+                         .arg(percentile(base, 0.95f), 0, 'f', 3)
+                         .arg(slower)
+                         .arg(worstFrame)
+                         .arg(worstDelta, 0, 'f', 3);
+    if (baseline.size() != current.size()) {
+        report += QString(" (frame count differs: baseline %1, current %2)").arg(baseline.size()).arg(current.size());
+    }
+    return report;
+}
+
+}
@@ -0,0 +1,71 @@
+#ifndef INPUTRECORDER_H
+#define INPUTRECORDER_H
+
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QFile>
+#include <QString>
+#include <vector>
+
+enum class InputEventType : quint8 {
+    KeyPress,
+    MousePress,
+    MouseMove,
+    Projection,
+    KeyRelease,
+    MouseRelease
+};
+
+struct InputEvent {
+    InputEventType type = InputEventType::KeyPress;
+    qint32 a = 0;   // 按键码 / 鼠标 x / 是否透视
+    qint32 b = 0;   // 鼠标 y
+};
+
+// 一帧内要重放的输入与时间步长
+struct RecordedFrame {
+    float deltaTime = 0.0f;
+    std::vector<InputEvent> events;
+};
+
+// 录制格式：文件头 + 配置内容 + 逐帧 (时间步长, 事件数, 紧凑编码的事件)
+class InputRecorder {
+public:
+    bool startRecording(const QString& path, const QByteArray& config);
+    bool loadReplay(const QString& path);
+    void stop();
+
+    bool isRecording() const { return recording; }
+    bool isReplaying() const { return replaying; }
+    const QByteArray& config() const { return recordedConfig; }
+
+    // 录制：事件先缓存，在下一帧开始时与该帧的时间步长一起写出
+    void record(const InputEvent& event);
+    void recordFrame(float deltaTime);
+
+    // 重放：依次取出每帧，取完返回 false
+    bool nextFrame(RecordedFrame& frame);
+    int frameCount() const { return int(frames.size()); }
+    int currentFrame() const { return replayIndex; }
+
+private:
+    QFile file;
+    QDataStream stream;
+    QByteArray recordedConfig;
+    std::vector<InputEvent> pendingEvents;
+    std::vector<RecordedFrame> frames;
+    int replayIndex = 0;
+    bool recording = false;
+    bool replaying = false;
+};
+
+// 重放的逐帧耗时，可保存为基线并与基线逐帧比较
+namespace FrameTimings {
+bool save(const QString& path, const std::vector<float>& milliseconds);
+bool load(const QString& path, std::vector<float>& milliseconds);
+QString compare(const std::vector<float>& baseline, const std::vector<float>& current);
+}
+
+
+#endif // INPUTRECORDER_H
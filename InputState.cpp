@@ -0,0 +1,49 @@
+#include "InputState.h"
+#include <algorithm>
+
+void InputState::keyDown(int key) {
+    if (!isDown(key)) {
+        heldKeys.push_back(key);
+    }
+}
+
+void InputState::keyUp(int key) {
+    heldKeys.erase(std::remove(heldKeys.begin(), heldKeys.end(), key), heldKeys.end());
+}
+
+bool InputState::isDown(int key) const {
+    return std::find(heldKeys.begin(), heldKeys.end(), key) != heldKeys.end();
+}
+
+void InputState::mouseDown(int x, int y) {
+    buttonDown = true;
+    lastX = x;
+    lastY = y;
+}
+
+void InputState::mouseUp() {
+    buttonDown = false;
+}
+
+void InputState::mouseMove(int x, int y) {
+    if (buttonDown) {
+        deltaX += x - lastX;
+        deltaY += y - lastY;
+    }
+    lastX = x;
+    lastY = y;
+}
+
+void InputState::takeMouseDelta(int& dx, int& dy) {
+    dx = deltaX;
+    dy = deltaY;
+    deltaX = 0;
+    deltaY = 0;
+}
+
+void InputState::clear() {
+    heldKeys.clear();
+    buttonDown = false;
+    deltaX = 0;
+    deltaY = 0;
+}
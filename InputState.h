@@ -0,0 +1,31 @@
+#ifndef INPUTSTATE_H
+#define INPUTSTATE_H
+
+
+#include <vector>
+
+// 输入状态：事件只更新按键/按钮状态并累计鼠标位移，每帧统一读取一次
+class InputState {
+public:
+    void keyDown(int key);
+    void keyUp(int key);
+    bool isDown(int key) const;
+
+    void mouseDown(int x, int y);
+    void mouseUp();
+    void mouseMove(int x, int y);
+    // 取出本帧累计的鼠标位移并清零
+    void takeMouseDelta(int& dx, int& dy);
+
+    const std::vector<int>& keys() const { return heldKeys; }
+    void clear();
+
+private:
+    std::vector<int> heldKeys;
+    bool buttonDown = false;
+    int lastX = 0, lastY = 0;
+    int deltaX = 0, deltaY = 0;
+};
+
+
+#endif // INPUTSTATE_H
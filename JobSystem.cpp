@@ -0,0 +1,98 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+void JobSystem::start(int threads) {
+    stop();
+    if (threads <= 0) {
+        threads = QThread::idealThreadCount();
+    }
+    for (int i = 1; i < threads; i++) {
+        workers.push_back(std::make_unique<Worker>(this));
+        workers.back()->setObjectName(QString("job worker %1").arg(i));
+        workers.back()->start();
+    }
+}
+
+void JobSystem::stop() {
+    if (workers.empty()) {
+        return;
+    }
+    {
+        QMutexLocker locker(&mutex);
+        stopping = true;
+        wake.wakeAll();
+    }
+    for (std::unique_ptr<Worker>& worker : workers) {
+        worker->wait();
+    }
+    workers.clear();
+    stopping = false;
+}
+
+void JobSystem::parallelFor(int count, int chunkSize, const ChunkJob& chunkJob) {
+    int chunks = chunkCount(count, chunkSize);
+    if (chunks <= 1 || workers.empty()) {
+        for (int chunk = 0; chunk < chunks; chunk++) {
+            chunkJob(chunk, chunk * chunkSize, std::min(count, (chunk + 1) * chunkSize));
+        }
+        return;
+    }
+
+    QMutexLocker submitLocker(&submitMutex);
+    nextChunk.store(0, std::memory_order_relaxed);
+    {
+        QMutexLocker locker(&mutex);
+        job = &chunkJob;
+        jobCount = count;
+        jobChunkSize = chunkSize;
+        jobChunks = chunks;
+        generation++;
+        wake.wakeAll();
+    }
+
+    runChunks(chunkJob, count, chunkSize, chunks);
+
+    // 块已全部领取，等还在执行的工作线程做完；它们的写入经 mutex 对调用线程可见
+    QMutexLocker locker(&mutex);
+    job = nullptr;
+    while (busyWorkers > 0) {
+        idle.wait(&mutex);
+    }
+}
+
+void JobSystem::workerLoop() {
+    quint64 seen = 0;
+    while (true) {
+        const ChunkJob* current = nullptr;
+        int count = 0, chunkSize = 1, chunks = 0;
+        {
+            QMutexLocker locker(&mutex);
+            while (!stopping && (!job || generation == seen)) {
+                wake.wait(&mutex);
+            }
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            current = job;
+            count = jobCount;
+            chunkSize = jobChunkSize;
+            chunks = jobChunks;
+            busyWorkers++;
+        }
+
+        runChunks(*current, count, chunkSize, chunks);
+
+        QMutexLocker locker(&mutex);
+        if (--busyWorkers == 0) {
+            idle.wakeAll();
+        }
+    }
+}
+
+void JobSystem::runChunks(const ChunkJob& chunkJob, int count, int chunkSize, int chunks) {
+    for (int chunk = nextChunk.fetch_add(1, std::memory_order_relaxed); chunk < chunks;
+         chunk = nextChunk.fetch_add(1, std::memory_order_relaxed)) {
+        chunkJob(chunk, chunk * chunkSize, std::min(count, (chunk + 1) * chunkSize));
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// 常驻工作线程池：parallelFor 把区间切成块，调用线程与工作线程一起按原子计数领取，全部完成后才返回
+// 同一时刻只执行一个任务，多个线程同时提交时依次进行
+class JobSystem {
+public:
+    // 参数为块序号与 [begin, end)，块序号在 [0, chunkCount) 内，可直接作为各块输出的下标
+    using ChunkJob = std::function<void(int chunk, int begin, int end)>;
+
+    ~JobSystem() { stop(); }
+
+    // threads 为参与执行的线程总数（含调用线程），0 时按核数；1 时不创建工作线程
+    void start(int threads);
+    void stop();
+    int threadCount() const { return int(workers.size()) + 1; }
+
+    static int chunkCount(int count, int chunkSize) { return (count + chunkSize - 1) / chunkSize; }
+    // 只有一块或没有工作线程时直接在调用线程中执行
+    void parallelFor(int count, int chunkSize, const ChunkJob& job);
+
+private:
+    class Worker : public QThread {
+    public:
+        explicit Worker(JobSystem* owner) : owner(owner) {}
+
+    protected:
+        void run() override { owner->workerLoop(); }
+
+    private:
+        JobSystem* owner;
+    };
+
+    void workerLoop();
+    void runChunks(const ChunkJob& job, int count, int chunkSize, int chunks);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    QMutex submitMutex;
+    QMutex mutex;
+    QWaitCondition wake;    // 有新任务或要退出
+    QWaitCondition idle;    // 最后一个工作线程离开任务
+
+    // 当前任务，由 mutex 保护；job 为空时迟到的工作线程不再加入
+    const ChunkJob* job = nullptr;
+    int jobCount = 0;
+    int jobChunkSize = 1;
+    int jobChunks = 0;
+    quint64 generation = 0;
+    int busyWorkers = 0;
+    bool stopping = false;
+
+    std::atomic<int> nextChunk{ 0 };
+};
+
+
+#endif // JOBSYSTEM_H
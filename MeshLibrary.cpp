@@ -0,0 +1,294 @@
+#include "MeshLibrary.h"
+#include <algorithm>
+#include <cmath>
+#include <deque>
+
+namespace MeshLibrary {
+
+static const float PI = 3.14159265358979f;
+
+static void pushTexturedVertex(MeshData& mesh, const QVector3D& position, float u, float v) {
+    mesh.vertices.insert(mesh.vertices.end(), { position.x(), position.y(), position.z(), u, v });
+}
+
+MeshData box(float size, const QVector3D& color) {
+    MeshData mesh;
+    mesh.format = VertexFormat::Pos3Color3;
+    for (int corner = 0; corner < 8; corner++) {
+        for (int axis = 0; axis < 3; axis++) {
+            mesh.vertices.push_back(cornerSign(corner, axis) * size * 0.5f);
+        }
+        mesh.vertices.insert(mesh.vertices.end(), { color.x(), color.y(), color.z() });
+    }
+    mesh.indices.assign(CUBE_CORNER_INDICES.begin(), CUBE_CORNER_INDICES.end());
+    return mesh;
+}
+
+MeshData subdividedBox(int segments) {
+    // 每个面按纹理立方体的朝向划分为 segments x segments 个四边形
+    segments = std::max(segments, 1);
+    MeshData mesh;
+    mesh.format = VertexFormat::Pos3Tex2;
+    for (const CubeFace& face : CUBE_FACES) {
+        GLuint base = GLuint(mesh.vertexCount());
+        for (int j = 0; j <= segments; j++) {
+            for (int i = 0; i <= segments; i++) {
+                float u = float(i) / segments;
+                float v = float(j) / segments;
+                float position[3] = {};
+                position[face.normalAxis] = 0.5f * face.normalSign;
+                position[face.uAxis] = (u - 0.5f) * face.uSign;
+                position[face.vAxis] = (v - 0.5f) * face.vSign;
+                pushTexturedVertex(mesh, QVector3D(position[0], position[1], position[2]), u, v);
+            }
+        }
+        for (int j = 0; j < segments; j++) {
+            for (int i = 0; i < segments; i++) {
+                GLuint a = base + GLuint(j * (segments + 1) + i);
+                GLuint b = a + 1;
+                GLuint c = a + GLuint(segments + 1) + 1;
+                GLuint d = a + GLuint(segments + 1);
+                mesh.indices.insert(mesh.indices.end(), { a, b, c, c, d, a });
+            }
+        }
+    }
+    return mesh;
+}
+
+MeshData sphere(int slices, int stacks) {
+    // 半径 0.5 的经纬球，接缝处的顶点重复以保证纹理坐标连续
+    slices = std::max(slices, 3);
+    stacks = std::max(stacks, 2);
+    MeshData mesh;
+    mesh.format = VertexFormat::Pos3Tex2;
+    for (int j = 0; j <= stacks; j++) {
+        float v = float(j) / stacks;
+        float phi = v * PI;
+        for (int i = 0; i <= slices; i++) {
+            float u = float(i) / slices;
+            float theta = u * 2.0f * PI;
+            QVector3D position(std::sin(phi) * std::cos(theta), -std::cos(phi), std::sin(phi) * std::sin(theta));
+            pushTexturedVertex(mesh, position * 0.5f, u, v);
+        }
+    }
+    for (int j = 0; j < stacks; j++) {
+        for (int i = 0; i < slices; i++) {
+            GLuint a = GLuint(j * (slices + 1) + i);
+            GLuint b = a + 1;
+            GLuint c = a + GLuint(slices + 1) + 1;
+            GLuint d = a + GLuint(slices + 1);
+            // 两极处的退化三角形直接略去
+            if (j != 0) {
+                mesh.indices.insert(mesh.indices.end(), { a, b, c });
+            }
+            if (j != stacks - 1) {
+                mesh.indices.insert(mesh.indices.end(), { c, d, a });
+            }
+        }
+    }
+    return mesh;
+}
+
+MeshData cylinder(int slices) {
+    // 半径 0.5、高 1、轴为 y 的圆柱，侧面与两个底面的顶点分开以保持各自的纹理坐标
+    slices = std::max(slices, 3);
+    MeshData mesh;
+    mesh.format = VertexFormat::Pos3Tex2;
+    for (int i = 0; i <= slices; i++) {
+        float u = float(i) / slices;
+        float theta = u * 2.0f * PI;
+        float x = 0.5f * std::cos(theta);
+        float z = 0.5f * std::sin(theta);
+        pushTexturedVertex(mesh, QVector3D(x, -0.5f, z), u, 0.0f);
+        pushTexturedVertex(mesh, QVector3D(x, 0.5f, z), u, 1.0f);
+    }
+    for (int i = 0; i < slices; i++) {
+        GLuint a = GLuint(i * 2);
+        mesh.indices.insert(mesh.indices.end(), { a, a + 2, a + 3, a + 3, a + 1, a });
+    }
+
+    for (int cap = 0; cap < 2; cap++) {
+        float y = cap == 0 ? -0.5f : 0.5f;
+        GLuint center = GLuint(mesh.vertexCount());
+        pushTexturedVertex(mesh, QVector3D(0.0f, y, 0.0f), 0.5f, 0.5f);
+        for (int i = 0; i < slices; i++) {
+            float theta = float(i) / slices * 2.0f * PI;
+            float c = std::cos(theta);
+            float s = std::sin(theta);
+            pushTexturedVertex(mesh, QVector3D(0.5f * c, y, 0.5f * s), 0.5f + 0.5f * c, 0.5f + 0.5f * s);
+        }
+        for (int i = 0; i < slices; i++) {
+            GLuint a = center + 1 + GLuint(i);
+            GLuint b = center + 1 + GLuint((i + 1) % slices);
+            mesh.indices.insert(mesh.indices.end(), { center, a, b });
+        }
+    }
+    return mesh;
+}
+
+float acmr(const std::vector<GLuint>& indices, int cacheSize) {
+    if (indices.size() < 3) {
+        return 0.0f;
+    }
+    std::deque<GLuint> cache;
+    int misses = 0;
+    for (GLuint index : indices) {
+        if (std::find(cache.begin(), cache.end(), index) != cache.end()) {
+            continue;
+        }
+        misses++;
+        cache.push_back(index);
+        if (int(cache.size()) > cacheSize) {
+            cache.pop_front();
+        }
+    }
+    return float(misses) / (indices.size() / 3);
+}
+
+// Forsyth 算法的参数：模拟的 LRU 缓存大小及评分曲线
+static const int FORSYTH_CACHE_SIZE = 32;
+
+static float vertexScore(int cachePosition, int remainingTriangles) {
+    if (remainingTriangles == 0) {
+        return -1.0f;
+    }
+    float score = 0.0f;
+    if (cachePosition >= 0 && cachePosition < FORSYTH_CACHE_SIZE) {
+        if (cachePosition < 3) {
+            // 刚用过的三个顶点给固定分，避免总是紧接着用同一条边
+            score = 0.75f;
+        } else {
+            float scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scale, 1.5f);
+        }
+    }
+    // 剩余三角形越少越优先，尽早清掉孤立的顶点
+    score += 2.0f * std::pow(float(remainingTriangles), -0.5f);
+    return score;
+}
+
+void optimizeVertexCache(MeshData& mesh) {
+    int vertexCount = mesh.vertexCount();
+    int triangleCount = int(mesh.indices.size() / 3);
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // 每个顶点相邻的未输出三角形，按 offsets 分段存放
+    std::vector<int> remaining(vertexCount, 0);
+    for (GLuint index : mesh.indices) {
+        remaining[index]++;
+    }
+    std::vector<int> offsets(vertexCount + 1, 0);
+    for (int v = 0; v < vertexCount; v++) {
+        offsets[v + 1] = offsets[v] + remaining[v];
+    }
+    std::vector<int> adjacency(mesh.indices.size());
+    std::vector<int> filled(vertexCount, 0);
+    for (int t = 0; t < triangleCount; t++) {
+        for (int k = 0; k < 3; k++) {
+            GLuint v = mesh.indices[t * 3 + k];
+            adjacency[offsets[v] + filled[v]++] = t;
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> scores(vertexCount);
+    for (int v = 0; v < vertexCount; v++) {
+        scores[v] = vertexScore(-1, remaining[v]);
+    }
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    for (int t = 0; t < triangleCount; t++) {
+        triangleScores[t] = scores[mesh.indices[t * 3]] + scores[mesh.indices[t * 3 + 1]] + scores[mesh.indices[t * 3 + 2]];
+    }
+
+    std::vector<GLuint> result;
+    result.reserve(mesh.indices.size());
+    std::vector<GLuint> cache, nextCache;
+    int best = int(std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+    while (int(result.size()) < triangleCount * 3) {
+        if (best < 0) {
+            // 缓存中的顶点都用完了，在剩余三角形中整体找最高分
+            float bestScore = -1.0f;
+            for (int t = 0; t < triangleCount; t++) {
+                if (!emitted[t] && triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    best = t;
+                }
+            }
+        }
+
+        emitted[best] = true;
+        GLuint triangle[3] = { mesh.indices[best * 3], mesh.indices[best * 3 + 1], mesh.indices[best * 3 + 2] };
+        nextCache.assign(triangle, triangle + 3);
+        for (GLuint v : triangle) {
+            result.push_back(v);
+            // 从顶点的相邻列表中移除该三角形
+            int* begin = &adjacency[offsets[v]];
+            int* end = begin + remaining[v];
+            *std::find(begin, end, best) = *(end - 1);
+            remaining[v]--;
+        }
+        for (GLuint v : cache) {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                nextCache.push_back(v);
+            }
+        }
+
+        // 更新缓存中顶点及其相邻三角形的评分，挤出缓存的顶点位置记为 -1
+        best = -1;
+        float bestScore = -1.0f;
+        for (size_t i = 0; i < nextCache.size(); i++) {
+            GLuint v = nextCache[i];
+            cachePosition[v] = i < size_t(FORSYTH_CACHE_SIZE) ? int(i) : -1;
+            scores[v] = vertexScore(cachePosition[v], remaining[v]);
+        }
+        for (GLuint v : nextCache) {
+            for (int a = 0; a < remaining[v]; a++) {
+                int t = adjacency[offsets[v] + a];
+                triangleScores[t] = scores[mesh.indices[t * 3]] + scores[mesh.indices[t * 3 + 1]] + scores[mesh.indices[t * 3 + 2]];
+                if (triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    best = t;
+                }
+            }
+        }
+        if (nextCache.size() > size_t(FORSYTH_CACHE_SIZE)) {
+            nextCache.resize(FORSYTH_CACHE_SIZE);
+        }
+        cache.swap(nextCache);
+    }
+    mesh.indices.swap(result);
+}
+
+void optimizeVertexFetch(MeshData& mesh) {
+    int floats = GeometryPool::floatsPerVertex(mesh.format);
+    std::vector<GLuint> remap(mesh.vertexCount(), GLuint(-1));
+    std::vector<float> vertices;
+    vertices.reserve(mesh.vertices.size());
+    GLuint next = 0;
+    for (GLuint& index : mesh.indices) {
+        if (remap[index] == GLuint(-1)) {
+            remap[index] = next++;
+            vertices.insert(vertices.end(), mesh.vertices.begin() + index * floats, mesh.vertices.begin() + (index + 1) * floats);
+        }
+        index = remap[index];
+    }
+    // 未被引用的顶点直接丢弃
+    mesh.vertices.swap(vertices);
+}
+
+QString optimize(MeshData& mesh, const QString& name) {
+    float before = acmr(mesh.indices);
+    optimizeVertexCache(mesh);
+    optimizeVertexFetch(mesh);
+    return QString("%1: %2 vertices, %3 triangles, ACMR %4 -> %5")
+        .arg(name)
+        .arg(mesh.vertexCount())
+        .arg(mesh.indices.size() / 3)
+        .arg(before, 0, 'f', 3)
+        .arg(acmr(mesh.indices), 0, 'f', 3);
+}
+
+}
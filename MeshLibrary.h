@@ -0,0 +1,148 @@
+#ifndef MESHLIBRARY_H
+#define MESHLIBRARY_H
+
+
+#include <QString>
+#include <QVector3D>
+#include <array>
+#include <vector>
+#include "GeometryPool.h"
+
+// 网格数据：顶点为 format 对应的 float 源数据，索引相对于网格的第一个顶点
+struct MeshData {
+    VertexFormat format = VertexFormat::Pos3;
+    std::vector<float> vertices;
+    std::vector<GLuint> indices;
+
+    int vertexCount() const { return int(vertices.size()) / GeometryPool::floatsPerVertex(format); }
+};
+
+// 编译期生成的固定网格
+template <size_t VertexFloats, size_t IndexCount>
+struct FixedMesh {
+    VertexFormat format = VertexFormat::Pos3;
+    std::array<float, VertexFloats> vertices = {};
+    std::array<GLuint, IndexCount> indices = {};
+
+    MeshData toMeshData() const {
+        MeshData mesh;
+        mesh.format = format;
+        mesh.vertices.assign(vertices.begin(), vertices.end());
+        mesh.indices.assign(indices.begin(), indices.end());
+        return mesh;
+    }
+};
+
+namespace MeshLibrary {
+
+// 立方体的 8 个角点：下标 0-3 为 z 负面，按 (-,-) (+,-) (+,+) (-,+) 绕一圈，4-7 为 z 正面
+constexpr float cornerSign(int corner, int axis) {
+    return axis == 0 ? (((corner & 3) == 1 || (corner & 3) == 2) ? 1.0f : -1.0f)
+         : axis == 1 ? ((corner & 2) ? 1.0f : -1.0f)
+                     : ((corner & 4) ? 1.0f : -1.0f);
+}
+
+constexpr std::array<GLuint, 36> CUBE_CORNER_INDICES = {
+    0, 1, 2, 2, 3, 0,
+    4, 5, 6, 6, 7, 4,
+    0, 1, 5, 5, 4, 0,
+    2, 3, 7, 7, 6, 2,
+    0, 3, 7, 7, 4, 0,
+    1, 2, 6, 6, 5, 1
+};
+
+// 天空盒：边长 2 的立方体，8 个共享角点
+constexpr FixedMesh<8 * 3, 36> makeSkybox() {
+    FixedMesh<8 * 3, 36> mesh;
+    mesh.format = VertexFormat::Pos3;
+    for (int corner = 0; corner < 8; corner++) {
+        for (int axis = 0; axis < 3; axis++) {
+            mesh.vertices[corner * 3 + axis] = cornerSign(corner, axis);
+        }
+    }
+    mesh.indices = CUBE_CORNER_INDICES;
+    return mesh;
+}
+
+// 立方体每个面的朝向与纹理坐标：法线轴、法线方向、u/v 对应的坐标轴与方向、4 个角的 (u, v)
+struct CubeFace {
+    int normalAxis;
+    float normalSign;
+    int uAxis;
+    float uSign;
+    int vAxis;
+    float vSign;
+    float corners[8];
+};
+
+constexpr CubeFace CUBE_FACES[6] = {
+    { 2, -1.0f, 0, 1.0f, 1, 1.0f, { 0, 0, 1, 0, 1, 1, 0, 1 } },
+    { 2, 1.0f, 0, 1.0f, 1, 1.0f, { 0, 0, 1, 0, 1, 1, 0, 1 } },
+    { 0, -1.0f, 1, 1.0f, 2, -1.0f, { 1, 0, 1, 1, 0, 1, 0, 0 } },
+    { 0, 1.0f, 1, 1.0f, 2, -1.0f, { 1, 0, 1, 1, 0, 1, 0, 0 } },
+    { 1, -1.0f, 0, 1.0f, 2, -1.0f, { 0, 1, 1, 1, 1, 0, 0, 0 } },
+    { 1, 1.0f, 0, 1.0f, 2, -1.0f, { 0, 1, 1, 1, 1, 0, 0, 0 } }
+};
+
+// 纹理立方体：边长 1，每面 4 个顶点各带纹理坐标
+constexpr FixedMesh<24 * 5, 36> makeTexturedCube() {
+    FixedMesh<24 * 5, 36> mesh;
+    mesh.format = VertexFormat::Pos3Tex2;
+    for (int face = 0; face < 6; face++) {
+        const CubeFace& f = CUBE_FACES[face];
+        for (int corner = 0; corner < 4; corner++) {
+            float u = f.corners[corner * 2];
+            float v = f.corners[corner * 2 + 1];
+            float* vertex = &mesh.vertices[(face * 4 + corner) * 5];
+            vertex[f.normalAxis] = 0.5f * f.normalSign;
+            vertex[f.uAxis] = (u - 0.5f) * f.uSign;
+            vertex[f.vAxis] = (v - 0.5f) * f.vSign;
+            vertex[3] = u;
+            vertex[4] = v;
+        }
+        GLuint base = GLuint(face * 4);
+        GLuint quad[6] = { base, base + 1, base + 2, base + 2, base + 3, base };
+        for (int i = 0; i < 6; i++) {
+            mesh.indices[face * 6 + i] = quad[i];
+        }
+    }
+    return mesh;
+}
+
+// 全屏平面：NDC 坐标与纹理坐标
+constexpr FixedMesh<4 * 4, 6> makeQuad() {
+    FixedMesh<4 * 4, 6> mesh;
+    mesh.format = VertexFormat::Pos2Tex2;
+    mesh.vertices = {
+        -1.0f,  1.0f,  0.0f, 1.0f,
+        -1.0f, -1.0f,  0.0f, 0.0f,
+         1.0f, -1.0f,  1.0f, 0.0f,
+         1.0f,  1.0f,  1.0f, 1.0f
+    };
+    mesh.indices = { 0, 1, 2, 0, 2, 3 };
+    return mesh;
+}
+
+inline constexpr auto SKYBOX = makeSkybox();
+inline constexpr auto TEXTURED_CUBE = makeTexturedCube();
+inline constexpr auto QUAD = makeQuad();
+
+// 运行时按参数生成的网格，纹理网格都放在边长 1 的包围盒内，中心在原点
+MeshData box(float size, const QVector3D& color);
+MeshData subdividedBox(int segments);
+MeshData sphere(int slices, int stacks);
+MeshData cylinder(int slices);
+
+// 以 FIFO 顶点缓存模拟的平均缓存未命中率：每个三角形的顶点变换次数
+float acmr(const std::vector<GLuint>& indices, int cacheSize = 16);
+// Forsyth 线性时间算法重排三角形，提高变换后顶点缓存的命中率
+void optimizeVertexCache(MeshData& mesh);
+// 按索引中首次出现的顺序重排顶点，提高取顶点时的访存局部性
+void optimizeVertexFetch(MeshData& mesh);
+// 依次执行以上两步，返回优化前后 ACMR 的报告
+QString optimize(MeshData& mesh, const QString& name);
+
+}
+
+
+#endif // MESHLIBRARY_H
@@ -0,0 +1,155 @@
+#include "Metrics.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QString>
+#include <QtAlgorithms>
+#include "GLResource.h"
+
+MetricHistogram Metrics::frameInterval;
+MetricHistogram Metrics::frameCpu;
+MetricHistogram Metrics::physicsStep;
+MetricHistogram Metrics::serverLatency;
+std::atomic<quint64> Metrics::frameCount{ 0 };
+std::atomic<quint64> Metrics::drawCallCount{ 0 };
+std::atomic<quint64> Metrics::culledCount{ 0 };
+std::atomic<quint64> Metrics::collisionCount{ 0 };
+std::atomic<quint64> Metrics::serverRequestCount{ 0 };
+std::atomic<quint64> Metrics::serverBusyMicros{ 0 };
+
+namespace {
+
+const struct {
+    GLObjectType type;
+    const char* name;
+} memoryTypes[] = {
+    { GLObjectType::Texture, "texture" },
+    { GLObjectType::Renderbuffer, "renderbuffer" },
+    { GLObjectType::Buffer, "buffer" }
+};
+
+void appendHistogram(QByteArray& text, const char* name, const char* help, const MetricHistogram& histogram) {
+    text += QByteArray("# HELP ") + name + " " + help + "\n";
+    text += QByteArray("# TYPE ") + name + " histogram\n";
+    quint64 cumulative = 0;
+    for (int i = 0; i < MetricHistogram::BUCKETS; i++) {
+        cumulative += histogram.bucket(i);
+        text += QString("%1_bucket{le=\"%2\"} %3\n").arg(name).arg(MetricHistogram::boundSeconds(i)).arg(cumulative).toUtf8();
+    }
+    text += QString("%1_bucket{le=\"+Inf\"} %2\n").arg(name).arg(histogram.count()).toUtf8();
+    text += QString("%1_sum %2\n").arg(name).arg(histogram.sumSeconds(), 0, 'f', 6).toUtf8();
+    text += QString("%1_count %2\n").arg(name).arg(histogram.count()).toUtf8();
+}
+
+void appendCounter(QByteArray& text, const char* name, const char* help, quint64 value) {
+    text += QByteArray("# HELP ") + name + " " + help + "\n";
+    text += QByteArray("# TYPE ") + name + " counter\n";
+    text += QString("%1 %2\n").arg(name).arg(value).toUtf8();
+}
+
+QJsonObject histogramJson(const MetricHistogram& histogram) {
+    double count = double(histogram.count());
+    return QJsonObject{
+        { "count", count },
+        { "meanMs", count > 0 ? histogram.sumSeconds() * 1000.0 / count : 0.0 },
+        { "p50Ms", histogram.quantileSeconds(0.5) * 1000.0 },
+        { "p95Ms", histogram.quantileSeconds(0.95) * 1000.0 },
+        { "p99Ms", histogram.quantileSeconds(0.99) * 1000.0 }
+    };
+}
+
+}
+
+void MetricHistogram::record(double ms) {
+    quint64 us = ms > 0.0 ? quint64(ms * 1000.0) : 0;
+    // 上界为 64 us 左移 i 位的第一个桶，即 us - 1 的位数减 6
+    int index = us <= FIRST_BOUND_US ? 0 : 64 - qCountLeadingZeroBits(us - 1) - 6;
+    if (index < BUCKETS) {
+        buckets[index].fetch_add(1, std::memory_order_relaxed);
+    }
+    total.fetch_add(1, std::memory_order_relaxed);
+    sumMicros.fetch_add(us, std::memory_order_relaxed);
+}
+
+double MetricHistogram::quantileSeconds(double q) const {
+    quint64 count = total.load(std::memory_order_relaxed);
+    if (count == 0) {
+        return 0.0;
+    }
+    quint64 rank = quint64(q * count);
+    quint64 cumulative = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        cumulative += bucket(i);
+        if (cumulative > rank) {
+            return boundSeconds(i);
+        }
+    }
+    return boundSeconds(BUCKETS - 1);
+}
+
+void Metrics::recordFrame(double intervalMs, double cpuMs, int drawCalls, int culled) {
+    frameInterval.record(intervalMs);
+    frameCpu.record(cpuMs);
+    frameCount.fetch_add(1, std::memory_order_relaxed);
+    drawCallCount.fetch_add(quint64(drawCalls), std::memory_order_relaxed);
+    culledCount.fetch_add(quint64(culled), std::memory_order_relaxed);
+}
+
+void Metrics::recordPhysics(double ms, int collisions) {
+    physicsStep.record(ms);
+    collisionCount.fetch_add(quint64(collisions), std::memory_order_relaxed);
+}
+
+void Metrics::recordServerRequest(double latencyMs) {
+    serverLatency.record(latencyMs);
+    serverRequestCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::recordServerBatch(double busyMs) {
+    serverBusyMicros.fetch_add(busyMs > 0.0 ? quint64(busyMs * 1000.0) : 0, std::memory_order_relaxed);
+}
+
+QByteArray Metrics::scrapeText() {
+    QByteArray text;
+    appendHistogram(text, "demo_frame_interval_seconds", "Time between the starts of consecutive frames.", frameInterval);
+    appendHistogram(text, "demo_frame_cpu_seconds", "CPU time spent on a frame by the rendering thread.", frameCpu);
+    appendHistogram(text, "demo_physics_step_seconds", "Time spent in one simulation step.", physicsStep);
+    appendCounter(text, "demo_frames_total", "Frames rendered by all views.", frameCount.load(std::memory_order_relaxed));
+    appendCounter(text, "demo_draw_calls_total", "Draw calls issued.", drawCallCount.load(std::memory_order_relaxed));
+    appendCounter(text, "demo_culled_objects_total", "Objects skipped by frustum or occlusion culling.", culledCount.load(std::memory_order_relaxed));
+    appendCounter(text, "demo_collisions_total", "Collisions with the static cubes.", collisionCount.load(std::memory_order_relaxed));
+    appendHistogram(text, "demo_server_latency_seconds", "Render server time from receiving a request to replying.", serverLatency);
+    appendCounter(text, "demo_server_requests_total", "Render server requests answered with an image.", serverRequestCount.load(std::memory_order_relaxed));
+    text += "# HELP demo_server_busy_seconds_total Time the render server spent processing batches.\n";
+    text += "# TYPE demo_server_busy_seconds_total counter\n";
+    text += QString("demo_server_busy_seconds_total %1\n").arg(serverBusyMicros.load(std::memory_order_relaxed) / 1e6, 0, 'f', 6).toUtf8();
+
+    text += "# HELP demo_gl_memory_bytes Estimated GPU memory held by live GL objects.\n";
+    text += "# TYPE demo_gl_memory_bytes gauge\n";
+    for (const auto& memory : memoryTypes) {
+        text += QString("demo_gl_memory_bytes{type=\"%1\"} %2\n").arg(memory.name).arg(GLResourceRegistry::liveBytes(memory.type)).toUtf8();
+    }
+    return text;
+}
+
+QByteArray Metrics::dumpJson(double collisionsPerSecond) {
+    QJsonObject memoryBytes;
+    for (const auto& memory : memoryTypes) {
+        memoryBytes.insert(memory.name, double(GLResourceRegistry::liveBytes(memory.type)));
+    }
+    QJsonObject json{
+        { "frames", double(frameCount.load(std::memory_order_relaxed)) },
+        { "frameInterval", histogramJson(frameInterval) },
+        { "frameCpu", histogramJson(frameCpu) },
+        { "physicsStep", histogramJson(physicsStep) },
+        { "drawCalls", double(drawCallCount.load(std::memory_order_relaxed)) },
+        { "culledObjects", double(culledCount.load(std::memory_order_relaxed)) },
+        { "collisions", double(collisionCount.load(std::memory_order_relaxed)) },
+        { "collisionsPerSecond", collisionsPerSecond },
+        { "serverRequests", double(serverRequestCount.load(std::memory_order_relaxed)) },
+        { "serverLatency", histogramJson(serverLatency) },
+        { "serverBusySeconds", serverBusyMicros.load(std::memory_order_relaxed) / 1e6 },
+        { "glMemoryBytes", memoryBytes }
+    };
+    return QJsonDocument(json).toJson(QJsonDocument::Compact);
+}
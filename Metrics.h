@@ -0,0 +1,62 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+
+#include <QByteArray>
+#include <atomic>
+
+// 耗时直方图：按 2 的幂分桶（上界 64 us、128 us ... 约 2 s），更大的值只计入总数
+// 记录只做三次 relaxed 原子加法，任意线程可同时记录，读取时各字段之间可能差一次记录
+class MetricHistogram {
+public:
+    static constexpr int BUCKETS = 16;
+    static constexpr quint64 FIRST_BOUND_US = 64;
+
+    void record(double ms);
+
+    quint64 count() const { return total.load(std::memory_order_relaxed); }
+    double sumSeconds() const { return sumMicros.load(std::memory_order_relaxed) / 1e6; }
+    quint64 bucket(int i) const { return buckets[i].load(std::memory_order_relaxed); }
+    static double boundSeconds(int i) { return double(FIRST_BOUND_US << i) / 1e6; }
+    // 由桶上界估计分位数（秒），落在最后一个桶之外时返回最大上界
+    double quantileSeconds(double q) const;
+
+private:
+    std::atomic<quint64> buckets[BUCKETS] = {};
+    std::atomic<quint64> total{ 0 };
+    std::atomic<quint64> sumMicros{ 0 };
+};
+
+// 进程内的运行指标：帧、物理、绘制调用、剔除和碰撞的计数与耗时分布，GL 显存取自 GLResourceRegistry
+// 绘制线程每帧调用 recordFrame、recordPhysics 各一次，导出时才格式化
+class Metrics {
+public:
+    // intervalMs 为与上一帧开始的间隔，cpuMs 为本帧在绘制线程上的耗时
+    static void recordFrame(double intervalMs, double cpuMs, int drawCalls, int culled);
+    static void recordPhysics(double ms, int collisions);
+    // --serve 模式：每个成功的请求记录一次从收到到回复的延迟，每批记录一次渲染线程的忙碌时间
+    static void recordServerRequest(double latencyMs);
+    static void recordServerBatch(double busyMs);
+
+    static quint64 collisions() { return collisionCount.load(std::memory_order_relaxed); }
+
+    // Prometheus 文本格式
+    static QByteArray scrapeText();
+    // 一个 JSON 对象，collisionsPerSecond 由调用方按两次导出之差求得
+    static QByteArray dumpJson(double collisionsPerSecond);
+
+private:
+    static MetricHistogram frameInterval;
+    static MetricHistogram frameCpu;
+    static MetricHistogram physicsStep;
+    static MetricHistogram serverLatency;
+    static std::atomic<quint64> frameCount;
+    static std::atomic<quint64> drawCallCount;
+    static std::atomic<quint64> culledCount;
+    static std::atomic<quint64> collisionCount;
+    static std::atomic<quint64> serverRequestCount;
+    static std::atomic<quint64> serverBusyMicros;
+};
+
+
+#endif // METRICS_H
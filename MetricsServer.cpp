@@ -0,0 +1,61 @@
+#include "MetricsServer.h"
+#include <QDebug>
+#include <QHostAddress>
+#include <QSaveFile>
+#include "Metrics.h"
+
+MetricsServer::MetricsServer(QObject* parent) : QObject(parent) {
+    connect(&server, &QTcpServer::newConnection, this, &MetricsServer::acceptConnections);
+    connect(&dumpTimer, &QTimer::timeout, this, &MetricsServer::dump);
+}
+
+bool MetricsServer::listen(quint16 port) {
+    if (!server.listen(QHostAddress::LocalHost, port)) {
+        qDebug() << "MetricsServer failed to listen!" << port << server.errorString();
+        return false;
+    }
+    qDebug().noquote() << QString("metrics: serving on http://127.0.0.1:%1/metrics").arg(server.serverPort());
+    return true;
+}
+
+void MetricsServer::startDump(const QString& path, int intervalMs) {
+    dumpPath = path;
+    lastCollisions = Metrics::collisions();
+    dumpClock.start();
+    dumpTimer.start(intervalMs);
+}
+
+void MetricsServer::acceptConnections() {
+    while (server.hasPendingConnections()) {
+        QTcpSocket* socket = server.nextPendingConnection();
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { respond(socket); });
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    }
+}
+
+void MetricsServer::respond(QTcpSocket* socket) {
+    // 请求头收齐后再回复，请求行与头部的内容不关心
+    if (!socket->peek(socket->bytesAvailable()).contains("\r\n\r\n")) {
+        return;
+    }
+    socket->readAll();
+    QByteArray body = Metrics::scrapeText();
+    socket->write("HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nConnection: close\r\nContent-Length: " +
+                  QByteArray::number(body.size()) + "\r\n\r\n");
+    socket->write(body);
+    socket->disconnectFromHost();
+}
+
+void MetricsServer::dump() {
+    // 每秒碰撞数按两次导出之间的增量计算
+    double seconds = dumpClock.restart() / 1000.0;
+    quint64 collisions = Metrics::collisions();
+    double collisionsPerSecond = seconds > 0.0 ? (collisions - lastCollisions) / seconds : 0.0;
+    lastCollisions = collisions;
+
+    // 先写临时文件再替换，读取方不会看到写了一半的内容
+    QSaveFile file(dumpPath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(Metrics::dumpJson(collisionsPerSecond) + "\n") < 0 || !file.commit()) {
+        qDebug() << "MetricsServer failed to write metrics file!" << dumpPath << file.errorString();
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QString>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+// 指标导出：在本机 TCP 端口上以最简 HTTP 返回 Prometheus 文本，路径不限；
+// 可选每隔一段时间把 JSON 快照原子地写入文件。都在所属线程的事件循环中进行，不影响绘制线程
+class MetricsServer : public QObject {
+    Q_OBJECT
+public:
+    explicit MetricsServer(QObject* parent = nullptr);
+
+    // 只监听 127.0.0.1
+    bool listen(quint16 port);
+    void startDump(const QString& path, int intervalMs = 1000);
+
+private:
+    void acceptConnections();
+    void respond(QTcpSocket* socket);
+    void dump();
+
+    QTcpServer server;
+    QTimer dumpTimer;
+    QString dumpPath;
+    QElapsedTimer dumpClock;
+    quint64 lastCollisions = 0;
+};
+
+
+#endif // METRICSSERVER_H
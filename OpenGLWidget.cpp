@@ -5,812 +5,588 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QCoreApplication>
+#include <algorithm>
+#include "Metrics.h"
 
-void CoreFunctionWidget::loadConfig() {
-    QFile file(":/config.json");
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qDebug() << "Failed to open config file!";
+void CoreFunctionWidget::loadScene() {
+    if (scene->isLoaded()) {
         return;
     }
 
-    QByteArray data = file.readAll();
-    QJsonDocument doc(QJsonDocument::fromJson(data));
-    QJsonObject json = doc.object();
-
-    // 读取 cube1 配置
-    QJsonObject cube1 = json["cube1"].toObject();
-    cube1Size = cube1["size"].toDouble();
-    cube1Position = QVector3D(cube1["position"].toArray()[0].toDouble(),
-                              cube1["position"].toArray()[1].toDouble(),
-                              cube1["position"].toArray()[2].toDouble());
-    cube1Rotation = QVector3D(cube1["rotation"].toArray()[0].toDouble(),
-                              cube1["rotation"].toArray()[1].toDouble(),
-                              cube1["rotation"].toArray()[2].toDouble());
-    cube1Color = QVector3D(cube1["color"].toArray()[0].toDouble(),
-                           cube1["color"].toArray()[1].toDouble(),
-                           cube1["color"].toArray()[2].toDouble());
-
-    // 读取 cube2 配置
-    QJsonObject cube2 = json["cube2"].toObject();
-    cube2Size = cube2["size"].toDouble();
-    cube2Position = QVector3D(cube2["position"].toArray()[0].toDouble(),
-                              cube2["position"].toArray()[1].toDouble(),
-                              cube2["position"].toArray()[2].toDouble());
-    cube2Rotation = QVector3D(cube2["rotation"].toArray()[0].toDouble(),
-                              cube2["rotation"].toArray()[1].toDouble(),
-                              cube2["rotation"].toArray()[2].toDouble());
-    cube2Color = QVector3D(cube2["color"].toArray()[0].toDouble(),
-                           cube2["color"].toArray()[1].toDouble(),
-                           cube2["color"].toArray()[2].toDouble());
-
-    // 读取 cube 速度
-    QJsonObject cube = json["cube"].toObject();
-    cubeVelocity = QVector3D(cube["velocity"].toArray()[0].toDouble(),
-                                cube["velocity"].toArray()[1].toDouble(),
-                                cube["velocity"].toArray()[2].toDouble());
-
-    // 读取滤镜配置
-    QString filter = json["filter"].toString();
-    if (filter == "invert") {
-        currentFilter = Filter::Invert;
-    } else if (filter == "gray") {
-        currentFilter = Filter::Gray;
+    // 重放时使用录制文件中保存的配置
+    QByteArray data;
+    if (recorder.isReplaying()) {
+        data = recorder.config();
+    } else {
+        QFile file(":/config.json");
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            qDebug() << "Failed to open config file!";
+            return;
+        }
+        data = file.readAll();
+        if (!recordPath.isEmpty()) {
+            recorder.startRecording(recordPath, data);
+        }
+    }
+    scene->load(data);
+}
+
+void CoreFunctionWidget::loadConfig() {
+    // 跟随视图使用驱动视图的场景，谁先初始化谁负责加载
+    if (follower && driver) {
+        driver->loadScene();
     } else {
-        currentFilter = Filter::None;
+        loadScene();
     }
 
+    settings.filter = scene->filter;
+    settings.depthPrepass = scene->depthPrepass;
+    settings.overdraw = scene->overdraw;
+    settings.occlusion = scene->occlusion;
 }
 
-CoreFunctionWidget::CoreFunctionWidget(QWidget* parent) : QOpenGLWidget(parent)
+CoreFunctionWidget::CoreFunctionWidget(QWidget* parent, CoreFunctionWidget* driver)
+    : QOpenGLWidget(parent), driver(driver), follower(driver != nullptr)
 {
     this->setFocusPolicy(Qt::StrongFocus);
     // 初始化定时器
     timer.start();
 
-    connect(&updateTimer, &QTimer::timeout, this, [this]() { QMetaObject::invokeMethod(this, "update", Qt::QueuedConnection); });
-    updateTimer.start(16); // 每16毫秒触发一次，相当于60帧每秒
+    if (follower) {
+        // 跟随视图没有自己的定时器，驱动视图每帧推进场景后触发其重绘
+        scene = driver->scene;
+        driver->followers.push_back(this);
+    } else {
+        scene = std::make_shared<Scene>();
+        connect(&updateTimer, &QTimer::timeout, this, [this]() { requestRepaint(); });
+        updateTimer.start(16); // 每16毫秒触发一次，相当于60帧每秒
+    }
+
+    inputClock.start();
+    connect(this, &QOpenGLWidget::frameSwapped, this, &CoreFunctionWidget::onFrameSwapped);
 }
 
 CoreFunctionWidget::~CoreFunctionWidget()
 {
-    glDeleteVertexArrays(1, &cubeVAO);
-    glDeleteBuffers(1, &cubeVBO);
-    glDeleteBuffers(1, &EBO);
+    recorder.stop();
+    for (CoreFunctionWidget* view : followers) {
+        view->driver = nullptr;
+    }
+    if (driver) {
+        driver->followers.erase(std::remove(driver->followers.begin(), driver->followers.end(), this), driver->followers.end());
+    }
+
+    // 渲染线程先退出并删除自己上下文中的对象，共享资源最后释放
+    delete renderThread;
+    renderThread = nullptr;
+
+    makeCurrent();
+    capture.stop();
+    renderer.destroy();
+    compositeFbo.reset();
+    if (resources) {
+        SharedResources::release(this);
+    }
+    doneCurrent();
+}
+
+void CoreFunctionWidget::setViewIndex(int index, int count) {
+    viewIndex = index;
+    viewAngle = 360.0f * index / count;
 }
 
 
 void CoreFunctionWidget::initializeGL() {
     this->initializeOpenGLFunctions();
+#ifdef GL_TRACE
+    startValidation();
+#endif
 
     glEnable(GL_DEPTH_TEST);
     this->cam.set_initial_distance_ratio(8.0);
+    // 多视口时各视图从不同方位观察同一场景
+    if (viewAngle != 0.0f) {
+        this->cam.rotate_left(viewAngle);
+    }
     
     loadConfig(); // 加载配置文件
 
-    setupShaders();
-    setupTextures();
-    setupVertices();
-    setupFrameBuffer();
+    // 着色器、纹理和几何缓冲由所有视图共享，本视图只创建 VAO 和帧缓冲
+    resources = SharedResources::acquire(this, *scene);
+
+    // 渲染线程独占场景的推进，多视图、录制、重放与捕获都要求在本线程按帧同步
+    if (threadedRendering && (follower || !followers.empty() || recorder.isReplaying() || !recordPath.isEmpty() || !capturePath.isEmpty())) {
+        qDebug() << "Threaded rendering needs a single view without record, replay or capture; rendering on the GUI thread";
+        threadedRendering = false;
+    }
+    if (threadedRendering) {
+        compositeFbo.create(this);
+        renderThread = new RenderThread(context(), scene, resources);
+        connect(renderThread, &RenderThread::frameReady, this, [this]() { update(); });
+        connect(renderThread, &RenderThread::collisionDetected, this, &CoreFunctionWidget::collisionDetected);
+        renderThread->start();
+        qDebug().noquote() << QString("view %1: shared resources x%2 (geometry %3 KB), rendering on a dedicated thread")
+                                  .arg(viewIndex)
+                                  .arg(SharedResources::refCount())
+                                  .arg((resources->geometry.vertexBytes() + resources->geometry.indexBytes()) / 1024);
+    } else {
+        renderer.init(resources, scene->framesInFlight, width(), height());
+#ifdef GL_TRACE
+        renderer.shareValidation(*this);
+#endif
+        qDebug().noquote() << QString("view %1: shared resources x%2 (geometry %3 KB), own framebuffer %4 KB")
+                                  .arg(viewIndex)
+                                  .arg(SharedResources::refCount())
+                                  .arg((resources->geometry.vertexBytes() + resources->geometry.indexBytes()) / 1024)
+                                  .arg(qint64(renderer.width()) * renderer.height() * 7 / 1024);
+    }
+    
+    if (!capturePath.isEmpty()) {
+        capture.start(this, capturePath, captureFormat);
+    }
     
     timer.start(); // 初始化计时器
-
-    // 设置边界 AABB
-    boundaryAABB.min = QVector3D(-5.0f, -5.0f, -5.0f);
-    boundaryAABB.max = QVector3D(5.0f, 5.0f, 5.0f);
+    statsTimer.start();
 }
 
-void CoreFunctionWidget::setupShaders() {
-    // 初始化着色器
-    bool success = shaderProgram.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/textures.vert");
-    if (!success) {
-        qDebug() << "shaderProgram addShaderFromSourceFile failed!" << shaderProgram.log();
-        return;
-    }
 
-    success = shaderProgram.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/textures.frag");
-    if (!success) {
-        qDebug() << "shaderProgram addShaderFromSourceFile failed!" << shaderProgram.log();
-        return;
+void CoreFunctionWidget::resizeGL(int w, int h) {
+    glViewport(0, 0, w, h);
+    // 渲染线程按每帧快照中的尺寸自行调整
+    if (!renderThread) {
+        renderer.resize(w, h);
     }
+}
 
-    success = shaderProgram.link();
-    if (!success) {
-        qDebug() << "shaderProgram link failed!" << shaderProgram.log();
-    }
+void CoreFunctionWidget::paintGL() {
+    frameTimer.start();
+    repaintPending = false;
 
-    // 初始化天空盒着色器
-    success = skyboxShaderProgram.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/skybox.vert");
-    if (!success) {
-        qDebug() << "skyboxShaderProgram addShaderFromSourceFile failed!" << skyboxShaderProgram.log();
-        return;
-    }
+    // 计算时间差
+    qint64 currentTime = timer.elapsed();
+    deltaTime = currentTime / 1000.0f;
+    timer.restart();
 
-    success = skyboxShaderProgram.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/skybox.frag");
-    if (!success) {
-        qDebug() << "skyboxShaderProgram addShaderFromSourceFile failed!" << skyboxShaderProgram.log();
+    // 重放时输入和时间步长都取自录制文件，保证逐帧一致
+    if (follower) {
+        // 跟随视图不参与录制与重放
+    } else if (recorder.isReplaying()) {
+        RecordedFrame frame;
+        if (!recorder.nextFrame(frame)) {
+            finishReplay();
+            return;
+        }
+        for (const InputEvent& event : frame.events) {
+            applyInput(event);
+        }
+        deltaTime = frame.deltaTime;
+    } else {
+        recorder.recordFrame(deltaTime);
+    }
+
+    // 每帧采样一次输入，按帧时间缩放
+    frameInputTimestamp = inputTimestamp;
+    inputTimestamp = -1;
+    applyFrameInput(deltaTime);
+
+    QMatrix4x4 view = this->cam.get_camera_matrix();
+    QMatrix4x4 projection = projectionMatrix();
+
+    if (renderThread) {
+        // 只发布相机快照并合成渲染线程最近完成的一帧
+        ViewSnapshot snapshot;
+        snapshot.view = view;
+        snapshot.projection = projection;
+        snapshot.settings = settings;
+        snapshot.width = width();
+        snapshot.height = height();
+        renderThread->publishView(snapshot);
+        compositeFrame();
+
+        stats.frames++;
+        if (statsTimer.elapsed() >= 1000) {
+            reportStats();
+        }
         return;
     }
 
-    success = skyboxShaderProgram.link();
-    if (!success) {
-        qDebug() << "skyboxShaderProgram link failed!" << skyboxShaderProgram.log();
-    }
+    // 场景只由驱动视图推进一次，跟随视图绘制同一帧的状态
+    if (!follower) {
+        resources->streaming.beginFrame();
+        QElapsedTimer physicsTimer;
+        physicsTimer.start();
+        scene->step(deltaTime, collisionHits);
+        double physicsMs = physicsTimer.nsecsElapsed() / 1000000.0;
+        stats.physicsMsSum += physicsMs;
+        stats.physicsSamples++;
+        Metrics::recordPhysics(physicsMs, int(collisionHits.size()));
+        // 拾取用的 BVH 每步重新拟合一次，点击时只做查询；跟随视图共用这一棵
+        scene->bounds(pickBounds);
+        pickBvh.update(pickBounds);
+        for (int hit : collisionHits) {
+            emit collisionDetected(QString("Cube: %1!").arg(hit));
+        }
 
-    // 初始化方块着色器
-    success = cubeShaderProgram.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/cube.vert");
-    if (!success) {
-        qDebug() << "cubeShaderProgram addShaderFromSourceFile failed!" << cubeShaderProgram.log();
-        return;
+        renderer.updateParticles(deltaTime, scene->boundaryAABB, stats);
+        if (resources->particles.count() > 0 && !followers.empty()) {
+            // 跟随视图在其他上下文中读取新状态
+            glFlush();
+        }
     }
 
-    success = cubeShaderProgram.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/cube.frag");
-    if (!success) {
-        qDebug() << "cubeShaderProgram addShaderFromSourceFile failed!" << cubeShaderProgram.log();
-        return;
-    }
+    // stats 每秒清零，按本帧前后之差导出
+    int drawCallsBefore = stats.drawCalls;
+    int culledBefore = stats.frustumCulled + stats.occlusionCulled;
+    renderer.render(*scene, view, projection, settings, defaultFramebufferObject(), stats);
 
-    success = cubeShaderProgram.link();
-    if (!success) {
-        qDebug() << "cubeShaderProgram link failed!" << cubeShaderProgram.log();
+    if (capture.isActive()) {
+        QElapsedTimer captureTimer;
+        captureTimer.start();
+        // 滤镜前的场景在帧缓冲对象中，最终画面在默认帧缓冲中
+        if (captureScene && settings.needsFramebuffer()) {
+            capture.capture(renderer.sceneFramebuffer(), renderer.width(), renderer.height());
+        } else {
+            qreal ratio = devicePixelRatioF();
+            capture.capture(defaultFramebufferObject(), int(width() * ratio), int(height() * ratio));
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+        stats.captureMsSum += captureTimer.nsecsElapsed() / 1000000.0;
+        stats.captureSamples++;
+        stats.captureDropped = capture.droppedFrames();
     }
 
-    // 初始化反色着色器
-    success = invertShaderProgram.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/invert.vert");
-    if (!success) {
-        qDebug() << "invertShaderProgram addShaderFromSourceFile failed!" << invertShaderProgram.log();
-        return;
+    if (recorder.isReplaying()) {
+        replayTimings.push_back(frameTimer.nsecsElapsed() / 1000000.0f);
     }
-    success = invertShaderProgram.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/invert.frag");
-    if (!success) {
-        qDebug() << "invertShaderProgram addShaderFromSourceFile failed!" << invertShaderProgram.log();
-        return;
+
+    for (CoreFunctionWidget* view : followers) {
+        view->requestRepaint();
     }
-    success = invertShaderProgram.link();
-    if (!success) {
-        qDebug() << "invertShaderProgram link failed!" << invertShaderProgram.log();
+
+    Metrics::recordFrame(deltaTime * 1000.0, frameTimer.nsecsElapsed() / 1000000.0, stats.drawCalls - drawCallsBefore,
+                         stats.frustumCulled + stats.occlusionCulled - culledBefore);
+    stats.frames++;
+    if (statsTimer.elapsed() >= 1000) {
+        reportStats();
     }
+}
 
-    // 初始化灰度着色器
-    success = grayShaderProgram.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/invert.vert");
-    if (!success) {
-        qDebug() << "grayShaderProgram addShaderFromSourceFile failed!" << grayShaderProgram.log();
-        return;
+void CoreFunctionWidget::compositeFrame() {
+    if (renderThread->takeFrame(this)) {
+        // 渲染线程推进场景，拾取只能用已合成帧的包围盒
+        pickBvh.update(renderThread->frame().bounds);
     }
-    success = grayShaderProgram.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/gray.frag");
-    if (!success) {
-        qDebug() << "grayShaderProgram addShaderFromSourceFile failed!" << grayShaderProgram.log();
+    const PresentedFrame& frame = renderThread->frame();
+    glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+    if (frame.width == 0) {
+        // 渲染线程还没有完成第一帧
+        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
         return;
     }
-    success = grayShaderProgram.link();
-    if (!success) {
-        qDebug() << "grayShaderProgram link failed!" << grayShaderProgram.log();
-    }
+
+    // 共享纹理挂到本上下文的帧缓冲上，拷贝到屏幕；尺寸变化的过渡帧按比例缩放
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, compositeFbo);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderThread->frameTexture(), 0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, defaultFramebufferObject());
+    glBlitFramebuffer(0, 0, frame.width, frame.height, 0, 0, width(), height(), GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+    renderThread->finishRead(this);
 }
 
-void CoreFunctionWidget::setupTextures() {
-    // 加载天空盒纹理
-    std::vector<std::string> faces
-    {
-        ":/res/skybox/right.jpg",
-        ":/res/skybox/left.jpg",
-        ":/res/skybox/top.jpg",
-        ":/res/skybox/bottom.jpg",
-        ":/res/skybox/front.jpg",
-        ":/res/skybox/back.jpg"
-    };
-    skyboxTexture = loadCubemap(faces);
-
-    // 加载盒子纹理
-    // texture 1
-    // ---------
-    glGenTextures(1, &texture1);
-    glBindTexture(GL_TEXTURE_2D, texture1);
-    // set the texture wrapping parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);   // set texture wrapping to GL_REPEAT (default wrapping method)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    // set texture filtering parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // load image, create texture and generate mipmaps
-    QImage img1 = QImage(":/res/cube/container.jpg").convertToFormat(QImage::Format_RGB888);
-    if (!img1.isNull()) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, img1.width(), img1.height(), 0, GL_RGB, GL_UNSIGNED_BYTE, img1.bits());
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-
-    // texture 2
-    // ---------
-    glGenTextures(1, &texture2);
-    glBindTexture(GL_TEXTURE_2D, texture2);
-    // set the texture wrapping parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);   // set texture wrapping to GL_REPEAT (default wrapping method)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    // set texture filtering parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // load image, create texture and generate mipmaps
-    QImage img2 = QImage(":/res/cube/awesomeface.png").convertToFormat(QImage::Format_RGBA8888).mirrored(true, true);
-    if (!img2.isNull()) {
-        // note that the awesomeface.png has transparency and thus an alpha channel, so make sure to tell OpenGL the data type is of GL_RGBA
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, img2.width(), img2.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, img2.bits());
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-
-    // tell opengl for each sampler to which texture unit it belongs to (only has to be done once)
-    shaderProgram.bind();   // don't forget to activate/use the shader before setting uniforms!
-    glUniform1i(shaderProgram.uniformLocation("texture1"), 0);
-    glUniform1i(shaderProgram.uniformLocation("texture2"), 1);
-    shaderProgram.release();
+QMatrix4x4 CoreFunctionWidget::projectionMatrix() const {
+    QMatrix4x4 projection;
+    if (this->use_perspective)
+        projection.perspective(90, 1.0, 0.01, 50.0);
+    else
+        projection.ortho(-2, 2, -2, 2, 0.01, 50.0);
+    return projection;
 }
 
-GLuint CoreFunctionWidget::loadCubemap(std::vector<std::string> faces) {
-    GLuint textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-    int width, height, nrChannels;
-    for (unsigned int i = 0; i < faces.size(); i++)
-    {
-        QImage img = QImage(faces[i].c_str()).convertToFormat(QImage::Format_RGB888);
-        if (!img.isNull())
-        {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, img.width(), img.height(), 0, GL_RGB, GL_UNSIGNED_BYTE, img.bits());
+void CoreFunctionWidget::reportStats() {
+    double seconds = statsTimer.restart() / 1000.0;
+    if (scene->logStats) {
+#ifdef GL_TRACE
+        // 场景绘制的调用记在 renderer 上，合成与捕获的调用记在本视图上
+        GLCallCounts calls = renderer.callCounts();
+        calls += callCounts();
+        QString message = stats.format(seconds, *resources, *scene, renderer.framesInFlight(), &calls);
+#else
+        QString message = stats.format(seconds, *resources, *scene, renderer.framesInFlight());
+#endif
+        if (follower || !followers.empty()) {
+            message.prepend(QString("view %1: ").arg(viewIndex));
+        } else if (renderThread) {
+            message.prepend("composite ");
         }
-        else
-        {
-            qDebug() << "Cubemap texture failed to load at path: " << faces[i].c_str();
+        qDebug().noquote() << message;
+        // GL 对象是全进程的，只由驱动视图输出
+        if (!follower) {
+            qDebug().noquote() << GLResourceRegistry::report();
         }
     }
-
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    return textureID;
+#ifdef GL_TRACE
+    callCounts().reset();
+    renderer.callCounts().reset();
+#endif
+    stats.reset();
 }
 
-void CoreFunctionWidget::setupVertices() {
-    // 设置天空盒 VAO 和 VBO
-    float skyboxVertices[] = {
-        // positions          
-        -1.0f,  1.0f, -1.0f,
-        -1.0f, -1.0f, -1.0f,
-         1.0f, -1.0f, -1.0f,
-         1.0f, -1.0f, -1.0f,
-         1.0f,  1.0f, -1.0f,
-        -1.0f,  1.0f, -1.0f,
-
-        -1.0f, -1.0f,  1.0f,
-        -1.0f, -1.0f, -1.0f,
-        -1.0f,  1.0f, -1.0f,
-        -1.0f,  1.0f, -1.0f,
-        -1.0f,  1.0f,  1.0f,
-        -1.0f, -1.0f,  1.0f,
-
-         1.0f, -1.0f, -1.0f,
-         1.0f, -1.0f,  1.0f,
-         1.0f,  1.0f,  1.0f,
-         1.0f,  1.0f,  1.0f,
-         1.0f,  1.0f, -1.0f,
-         1.0f, -1.0f, -1.0f,
-
-        -1.0f, -1.0f,  1.0f,
-        -1.0f,  1.0f,  1.0f,
-         1.0f,  1.0f,  1.0f,
-         1.0f,  1.0f,  1.0f,
-         1.0f, -1.0f,  1.0f,
-        -1.0f, -1.0f,  1.0f,
-
-        -1.0f,  1.0f, -1.0f,
-         1.0f,  1.0f, -1.0f,
-         1.0f,  1.0f,  1.0f,
-         1.0f,  1.0f,  1.0f,
-        -1.0f,  1.0f,  1.0f,
-        -1.0f,  1.0f, -1.0f,
-
-        -1.0f, -1.0f, -1.0f,
-        -1.0f, -1.0f,  1.0f,
-         1.0f, -1.0f, -1.0f,
-         1.0f, -1.0f, -1.0f,
-        -1.0f, -1.0f,  1.0f,
-         1.0f, -1.0f,  1.0f
-    };
-    
-    glGenVertexArrays(1, &skyboxVAO);
-    glGenBuffers(1, &skyboxVBO);
-    glBindVertexArray(skyboxVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glBindVertexArray(0);
-
-
-    // 设置立方体 VAO 和 VBO
-    float cube_vertices[] = {
-        -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, 0.0f,  0.0f, 0.0f,
-        0.5f, -0.5f, -0.5f,  0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-        0.5f,  0.5f, -0.5f,  0.0f, 0.0f, 0.0f, 1.0f, 1.0f,
-        -0.5f,  0.5f, -0.5f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
-
-        -0.5f, -0.5f,  0.5f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-        0.5f, -0.5f,  0.5f,  0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-        0.5f,  0.5f,  0.5f,  0.0f, 0.0f, 0.0f, 1.0f, 1.0f,
-        -0.5f,  0.5f,  0.5f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
-
-        -0.5f,  0.5f,  0.5f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-        -0.5f,  0.5f, -0.5f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f,
-        -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
-        -0.5f, -0.5f,  0.5f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-
-        0.5f,  0.5f,  0.5f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-        0.5f,  0.5f, -0.5f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f,
-        0.5f, -0.5f, -0.5f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
-        0.5f, -0.5f,  0.5f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-
-        -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
-        0.5f, -0.5f, -0.5f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f,
-        0.5f, -0.5f,  0.5f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-        -0.5f, -0.5f,  0.5f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-
-        -0.5f,  0.5f, -0.5f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
-        0.5f,  0.5f, -0.5f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f,
-        0.5f,  0.5f,  0.5f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
-        -0.5f,  0.5f,  0.5f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-    };
-    
-    unsigned int cube_indices[] = {
-        0, 1, 2,
-        2, 3, 0,
-        4, 5, 6,
-        6, 7, 4,
-        8, 9, 10,
-        10, 11, 8,
-        12, 13, 14,
-        14, 15, 12,
-        16, 17, 18,
-        18, 19, 16,
-        20, 21, 22,
-        22, 23, 20,
-    };
-
-    glGenVertexArrays(1, &cubeVAO);
-    glGenBuffers(1, &cubeVBO);
-    glGenBuffers(1, &EBO);
-    // bind the Vertex Array Object first, then bind and set vertex buffer(s), and then configure vertex attributes(s).
-    glBindVertexArray(cubeVAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(cube_vertices), cube_vertices, GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices, GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // color attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // texture coord attribute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-    glBindVertexArray(0);   //取消VAO绑定
-    glBindBuffer(GL_ARRAY_BUFFER, 0);//取消VBO的绑定
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-    // 设置立方体1
-    setupCube(cube1VAO, cube1VBO, cube1Size, cube1Color);
-
-    // 设置立方体2
-    setupCube(cube2VAO, cube2VBO, cube2Size, cube2Color);
-
-    // 设置平面
-    
-    float quadVertices[] = {
-        // positions   // texCoords
-        -1.0f,  1.0f,  0.0f, 1.0f,
-        -1.0f, -1.0f,  0.0f, 0.0f,
-         1.0f, -1.0f,  1.0f, 0.0f,
-
-        -1.0f,  1.0f,  0.0f, 1.0f,
-         1.0f, -1.0f,  1.0f, 0.0f,
-         1.0f,  1.0f,  1.0f, 1.0f
-    };
-
-    glGenVertexArrays(1, &quadVAO);
-    glGenBuffers(1, &quadVBO);
-    glBindVertexArray(quadVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-    glBindVertexArray(0);
 
+void CoreFunctionWidget::startRecording(const QString& path) {
+    recordPath = path;
 }
 
-void CoreFunctionWidget::setupCube(GLuint &VAO, GLuint &VBO, float size, QVector3D color) {
-    float vertSize = size/2;
-    float vertices[] = {
-        // positions          // colors
-        -vertSize, -vertSize, -vertSize,  color.x(), color.y(), color.z(),
-         vertSize, -vertSize, -vertSize,  color.x(), color.y(), color.z(),
-         vertSize,  vertSize, -vertSize,  color.x(), color.y(), color.z(),
-        -vertSize,  vertSize, -vertSize,  color.x(), color.y(), color.z(),
-        -vertSize, -vertSize,  vertSize,  color.x(), color.y(), color.z(),
-         vertSize, -vertSize,  vertSize,  color.x(), color.y(), color.z(),
-         vertSize,  vertSize,  vertSize,  color.x(), color.y(), color.z(),
-        -vertSize,  vertSize,  vertSize,  color.x(), color.y(), color.z()
-    };
-
-    unsigned int indices[] = {
-        0, 1, 2, 2, 3, 0,
-        4, 5, 6, 6, 7, 4,
-        0, 1, 5, 5, 4, 0,
-        2, 3, 7, 7, 6, 2,
-        0, 3, 7, 7, 4, 0,
-        1, 2, 6, 6, 5, 1
-    };
-
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-
-    glBindVertexArray(VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    glBindVertexArray(0);
+void CoreFunctionWidget::startReplay(const QString& path, const QString& baseline, const QString& timings) {
+    if (!recorder.loadReplay(path)) {
+        return;
+    }
+    baselinePath = baseline;
+    timingsPath = timings;
+    replayTimings.reserve(recorder.frameCount());
+    qDebug() << "Replaying" << recorder.frameCount() << "frames from" << path;
 }
 
+void CoreFunctionWidget::startCapture(const QString& directory, CaptureFormat format, bool sceneOnly) {
+    capturePath = directory;
+    captureFormat = format;
+    captureScene = sceneOnly;
+}
 
-void CoreFunctionWidget::setupFrameBuffer() {
-    glGenFramebuffers(1, &fbo);
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+void CoreFunctionWidget::setThreadedRendering(bool threaded) {
+    threadedRendering = threaded;
+}
 
-    // 创建颜色附件纹理
-    glGenTextures(1, &textureColorBuffer);
-    glBindTexture(GL_TEXTURE_2D, textureColorBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width(), height(), 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glBindTexture(GL_TEXTURE_2D, 0);
+void CoreFunctionWidget::finishReplay() {
+    recorder.stop();
+    qDebug() << "Replay finished after" << replayTimings.size() << "frames";
 
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureColorBuffer, 0);
+    if (!timingsPath.isEmpty()) {
+        FrameTimings::save(timingsPath, replayTimings);
+    }
+    if (!baselinePath.isEmpty()) {
+        std::vector<float> baseline;
+        if (FrameTimings::load(baselinePath, baseline)) {
+            qDebug().noquote() << FrameTimings::compare(baseline, replayTimings);
+        }
+    }
+    qDebug().noquote() << GLResourceRegistry::report();
+    QMetaObject::invokeMethod(QCoreApplication::instance(), "quit", Qt::QueuedConnection);
+}
 
-    // 创建渲染缓冲对象用于深度和模板测试
-    glGenRenderbuffers(1, &rbo);
-    glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width(), height());
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+void CoreFunctionWidget::applyInput(const InputEvent& event) {
+    switch (event.type) {
+        case InputEventType::KeyPress:
+            handleKeyPress(event.a);
+            break;
+        case InputEventType::KeyRelease:
+            input.keyUp(event.a);
+            break;
+        case InputEventType::MousePress:
+            handleMousePress(event.a, event.b);
+            break;
+        case InputEventType::MouseRelease:
+            input.mouseUp();
+            break;
+        case InputEventType::MouseMove:
+            input.mouseMove(event.a, event.b);
+            break;
+        case InputEventType::Projection:
+            this->use_perspective = event.a != 0;
+            emit projection_change();
+            break;
+    }
+}
 
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
+void CoreFunctionWidget::setPerspective(bool perspective) {
+    if (recorder.isReplaying()) {
+        return;
+    }
+    recorder.record({ InputEventType::Projection, perspective ? 1 : 0, 0 });
+    this->use_perspective = perspective;
+    requestRepaint();
+}
 
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        qDebug() << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!";
+void CoreFunctionWidget::requestRepaint() {
+    // 两帧之间的多次请求合并为一次重绘
+    stats.repaintRequests++;
+    if (repaintPending) {
+        stats.redundantRepaints++;
+        return;
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    repaintPending = true;
+    update();
+}
 
+void CoreFunctionWidget::markInput() {
+    if (inputTimestamp < 0) {
+        inputTimestamp = inputClock.nsecsElapsed();
+    }
+    requestRepaint();
 }
 
+void CoreFunctionWidget::onFrameSwapped() {
+    // 从本帧消费的最早输入到画面交换的延迟
+    if (frameInputTimestamp < 0) {
+        return;
+    }
+    double latency = (inputClock.nsecsElapsed() - frameInputTimestamp) / 1000000.0;
+    stats.inputLatencySum += latency;
+    stats.inputLatencyMax = std::max(stats.inputLatencyMax, latency);
+    stats.inputLatencySamples++;
+    frameInputTimestamp = -1;
+}
 
-void CoreFunctionWidget::resizeGL(int w, int h) {
-    glViewport(0, 0, w, h);
+void CoreFunctionWidget::keyPressEvent(QKeyEvent* e) {
+    // 自动重复事件不再驱动相机，按住状态由每帧采样处理
+    if (recorder.isReplaying() || e->isAutoRepeat()) {
+        return;
+    }
+    recorder.record({ InputEventType::KeyPress, e->key(), 0 });
+    handleKeyPress(e->key());
+    markInput();
 }
 
-void CoreFunctionWidget::paintGL() {
-    // 绑定帧缓冲对象
-    if (currentFilter != Filter::None) {
-        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+void CoreFunctionWidget::keyReleaseEvent(QKeyEvent* e) {
+    if (recorder.isReplaying() || e->isAutoRepeat()) {
+        return;
     }
-    glEnable(GL_DEPTH_TEST);
+    recorder.record({ InputEventType::KeyRelease, e->key(), 0 });
+    input.keyUp(e->key());
+    markInput();
+}
 
-    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+void CoreFunctionWidget::focusOutEvent(QFocusEvent* e) {
+    QOpenGLWidget::focusOutEvent(e);
+    if (recorder.isReplaying()) {
+        return;
+    }
+    // 失去焦点时收不到释放事件，视为全部松开
+    for (int key : input.keys()) {
+        recorder.record({ InputEventType::KeyRelease, key, 0 });
+    }
+    recorder.record({ InputEventType::MouseRelease, 0, 0 });
+    input.clear();
+}
 
-    // 计算时间差
-    qint64 currentTime = timer.elapsed();
-    deltaTime = currentTime / 1000.0f;
-    timer.restart();
+void CoreFunctionWidget::mousePressEvent(QMouseEvent* e) {
+    if (recorder.isReplaying()) {
+        return;
+    }
+    int x = e->position().x();
+    int y = e->position().y();
+    recorder.record({ InputEventType::MousePress, x, y });
+    handleMousePress(x, y);
+    markInput();
+}
 
-    // 更新立方体位置
-    cubePosition += cubeVelocity * deltaTime;
-
-    // 计算立方体的 AABB
-    AABB cubeAABB = calculateAABB(cubePosition, 1.0f); // 动态立方体的大小为 1.0
-    AABB cube1AABB = calculateAABB(cube1Position, cube1Size);
-    AABB cube2AABB = calculateAABB(cube2Position, cube2Size);
-
-    // 检查动态立方体与静态立方体1的碰撞
-    CollisionFace collisionFace = checkCollision(cubeAABB, cube1AABB);
-    if (collisionFace != NO_COLLISION) {
-        QString message = QString("Cube: 1!");
-        emit collisionDetected(message);
-
-        if (collisionFace == COLLISION_X) {
-            cubeVelocity.setX(-cubeVelocity.x());
-        } else if (collisionFace == COLLISION_Y) {
-            cubeVelocity.setY(-cubeVelocity.y());
-        } else if (collisionFace == COLLISION_Z) {
-            cubeVelocity.setZ(-cubeVelocity.z());
-        }
-        // 调整位置以避免下一帧再次检测到碰撞
-        cubePosition += cubeVelocity * deltaTime;
-    }
-
-    // 检查动态立方体与静态立方体2的碰撞
-    collisionFace = checkCollision(cubeAABB, cube2AABB);
-    if (collisionFace != NO_COLLISION) {
-        QString message = QString("Cube: 2!");
-        emit collisionDetected(message);
-
-        if (collisionFace == COLLISION_X) {
-            cubeVelocity.setX(-cubeVelocity.x());
-        } else if (collisionFace == COLLISION_Y) {
-            cubeVelocity.setY(-cubeVelocity.y());
-        } else if (collisionFace == COLLISION_Z) {
-            cubeVelocity.setZ(-cubeVelocity.z());
-        }
-        // 调整位置以避免下一帧再次检测到碰撞
-        cubePosition += cubeVelocity * deltaTime;
-    }
-
-     // 检查与边界的碰撞
-    if (cubeAABB.min.x() < boundaryAABB.min.x() || cubeAABB.max.x() > boundaryAABB.max.x()) {
-        // QString message = "Boundary: X axis!";
-        // emit collisionDetected(message);
-        cubeVelocity.setX(-cubeVelocity.x());
-        // 调整位置以避免下一帧再次检测到碰撞
-        cubePosition.setX(cubePosition.x() + cubeVelocity.x() * deltaTime);
-    }
-    if (cubeAABB.min.y() < boundaryAABB.min.y() || cubeAABB.max.y() > boundaryAABB.max.y()) {
-        // QString message = "Boundary: Y axis!";
-        // emit collisionDetected(message);
-        cubeVelocity.setY(-cubeVelocity.y());
-        // 调整位置以避免下一帧再次检测到碰撞
-        cubePosition.setY(cubePosition.y() + cubeVelocity.y() * deltaTime);
-    }
-    if (cubeAABB.min.z() < boundaryAABB.min.z() || cubeAABB.max.z() > boundaryAABB.max.z()) {
-        // QString message = "Boundary: Z axis!";
-        // emit collisionDetected(message);
-        cubeVelocity.setZ(-cubeVelocity.z());
-        // 调整位置以避免下一帧再次检测到碰撞
-        cubePosition.setZ(cubePosition.z() + cubeVelocity.z() * deltaTime);
-    }
-
-    shaderProgram.bind();
-    {
-        // bind textures on corresponding texture units
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture1);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, texture2);
-
-        // render container
-        glBindVertexArray(cubeVAO);
-        // set uniform mats
-        QMatrix4x4 model_mat; // identity
-        model_mat.translate(cubePosition); // 使用更新后的位置
-        glUniformMatrix4fv(shaderProgram.uniformLocation("model"), 1, GL_FALSE, model_mat.data());
-        QMatrix4x4 camera_mat = this->cam.get_camera_matrix();
-        glUniformMatrix4fv(shaderProgram.uniformLocation("view"), 1, GL_FALSE, camera_mat.data());
-
-        QMatrix4x4 projection_matrix;
-        if (this->use_perspective)
-            projection_matrix.perspective(90, 1.0, 0.01, 50.0);
-        else
-            projection_matrix.ortho(-2, 2, -2, 2, 0.01, 50.0);
-
-        glUniformMatrix4fv(shaderProgram.uniformLocation("projection"), 1, GL_FALSE, projection_matrix.data());
-
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-    }
-    shaderProgram.release();
-
-    // 渲染天空盒
-    glDepthFunc(GL_LEQUAL);  // 更改深度函数，以便天空盒能在最远处绘制
-    skyboxShaderProgram.bind();
-    {
-        QMatrix4x4 view = this->cam.get_camera_matrix();
-        view.setColumn(3, QVector4D(0, 0, 0, 1));
-        QMatrix4x4 projection;
-        if (this->use_perspective)
-            projection.perspective(90, 1.0, 0.01, 50.0);
-        else
-            projection.ortho(-2, 2, -2, 2, 0.01, 50.0);
-
-        glUniformMatrix4fv(skyboxShaderProgram.uniformLocation("view"), 1, GL_FALSE, view.data());
-        glUniformMatrix4fv(skyboxShaderProgram.uniformLocation("projection"), 1, GL_FALSE, projection.data());
-        // 绘制天空盒
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-    }
-    skyboxShaderProgram.release();
-    glDepthFunc(GL_LESS); // 重置深度函数
-
-    // 渲染立方体1
-    cubeShaderProgram.bind();
-    {
-        QMatrix4x4 model;
-        model.translate(cube1Position);
-        model.rotate(cube1Rotation.x(), QVector3D(1.0f, 0.0f, 0.0f));
-        model.rotate(cube1Rotation.y(), QVector3D(0.0f, 1.0f, 0.0f));
-        model.rotate(cube1Rotation.z(), QVector3D(0.0f, 0.0f, 1.0f));
-        glUniformMatrix4fv(cubeShaderProgram.uniformLocation("model"), 1, GL_FALSE, model.data());
-        QMatrix4x4 view = this->cam.get_camera_matrix();
-        glUniformMatrix4fv(cubeShaderProgram.uniformLocation("view"), 1, GL_FALSE, view.data());
-        QMatrix4x4 projection;
-        if (this->use_perspective)
-            projection.perspective(90, 1.0, 0.01, 50.0);
-        else
-            projection.ortho(-2, 2, -2, 2, 0.01, 50.0);
-        glUniformMatrix4fv(cubeShaderProgram.uniformLocation("projection"), 1, GL_FALSE, projection.data());
-        glBindVertexArray(cube1VAO);
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-    }
-    cubeShaderProgram.release();
-
-    // 渲染立方体2
-    cubeShaderProgram.bind();
-    {
-        QMatrix4x4 model;
-        model.translate(cube2Position);
-        model.rotate(cube2Rotation.x(), QVector3D(1.0f, 0.0f, 0.0f));
-        model.rotate(cube2Rotation.y(), QVector3D(0.0f, 1.0f, 0.0f));
-        model.rotate(cube2Rotation.z(), QVector3D(0.0f, 0.0f, 1.0f));
-        glUniformMatrix4fv(cubeShaderProgram.uniformLocation("model"), 1, GL_FALSE, model.data());
-        QMatrix4x4 view = this->cam.get_camera_matrix();
-        glUniformMatrix4fv(cubeShaderProgram.uniformLocation("view"), 1, GL_FALSE, view.data());
-        QMatrix4x4 projection;
-        if (this->use_perspective)
-            projection.perspective(90, 1.0, 0.01, 50.0);
-        else
-            projection.ortho(-2, 2, -2, 2, 0.01, 50.0);
-        glUniformMatrix4fv(cubeShaderProgram.uniformLocation("projection"), 1, GL_FALSE, projection.data());
-        glBindVertexArray(cube2VAO);
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-    }
-
-    if (currentFilter != Filter::None) {
-        // 解绑帧缓冲对象
-        glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
-        // 清除默认帧缓冲
-        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+void CoreFunctionWidget::mouseReleaseEvent(QMouseEvent* e) {
+    if (recorder.isReplaying()) {
+        return;
+    }
+    int x = e->position().x();
+    int y = e->position().y();
+    recorder.record({ InputEventType::MouseRelease, x, y });
+    input.mouseUp();
+}
 
-        // 选择后期处理着色器
-        switch (currentFilter) {
-            case Filter::Invert:
-                invertShaderProgram.bind();
-                break;
-            case Filter::Gray:
-                grayShaderProgram.bind();
-                break;
-        }
-        {
-            glBindVertexArray(quadVAO);
-            glDisable(GL_DEPTH_TEST);
-            glBindTexture(GL_TEXTURE_2D, textureColorBuffer);	// use the color attachment texture as the texture of the quad plane
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-        }
+void CoreFunctionWidget::mouseMoveEvent(QMouseEvent* e) {
+    if (recorder.isReplaying()) {
+        return;
     }
+    int x = e->position().x();
+    int y = e->position().y();
+    recorder.record({ InputEventType::MouseMove, x, y });
+    input.mouseMove(x, y);
+    markInput();
 }
 
+void CoreFunctionWidget::handleKeyPress(int key) {
+    input.keyDown(key);
 
-AABB CoreFunctionWidget::calculateAABB(const QVector3D& position, float size) {
-    AABB aabb;
-    aabb.min = position - QVector3D(size, size, size) * 0.5f;
-    aabb.max = position + QVector3D(size, size, size) * 0.5f;
-    return aabb;
+    // 开关类按键在按下时立即生效
+    if (key == Qt::Key_T) {
+        this->use_perspective = !this->use_perspective;
+        emit projection_change();
+    }
+    else if (key == Qt::Key_P) {
+        settings.depthPrepass = !settings.depthPrepass;
+    }
+    else if (key == Qt::Key_O) {
+        settings.overdraw = !settings.overdraw;
+    }
+    else if (key == Qt::Key_Q) {
+        settings.occlusion = !settings.occlusion;
+    }
 }
 
-CollisionFace CoreFunctionWidget::checkCollision(const AABB& a, const AABB& b) {
-    bool collisionX = (a.min.x() <= b.max.x() && a.max.x() >= b.min.x());
-    bool collisionY = (a.min.y() <= b.max.y() && a.max.y() >= b.min.y());
-    bool collisionZ = (a.min.z() <= b.max.z() && a.max.z() >= b.min.z());
-
-    if (collisionX && collisionY && collisionZ) {
-        // Determine which face the collision occurred on
-        float overlapX = std::min(a.max.x() - b.min.x(), b.max.x() - a.min.x());
-        float overlapY = std::min(a.max.y() - b.min.y(), b.max.y() - a.min.y());
-        float overlapZ = std::min(a.max.z() - b.min.z(), b.max.z() - a.min.z());
-
-        if (overlapX < overlapY && overlapX < overlapZ) {
-            return COLLISION_X;
-        } else if (overlapY < overlapX && overlapY < overlapZ) {
-            return COLLISION_Y;
-        } else {
-            return COLLISION_Z;
-        }
-    }
+void CoreFunctionWidget::handleMousePress(int x, int y) {
+    input.mouseDown(x, y);
 
-    return NO_COLLISION;
+    pickObject(x, y);
 }
 
+void CoreFunctionWidget::applyFrameInput(float dt) {
+    const float moveSpeed = 6.0f;               // 单位/秒
+    const float zoomSpeed = 3.0f;               // 缩放/秒
+    const float rotateDegreesPerPixel = 1.0f;
 
-void CoreFunctionWidget::keyPressEvent(QKeyEvent* e) {
-    if (e->key() == Qt::Key_A) {
-        this->cam.translate_left(0.2);
+    if (input.isDown(Qt::Key_A)) {
+        this->cam.translate_left(moveSpeed * dt);
     }
-    else if (e->key() == Qt::Key_D) {
-        this->cam.translate_left(-0.2);
+    if (input.isDown(Qt::Key_D)) {
+        this->cam.translate_left(-moveSpeed * dt);
     }
-    else if (e->key() == Qt::Key_W) {
-        this->cam.translate_up(0.2);
+    if (input.isDown(Qt::Key_W)) {
+        this->cam.translate_up(moveSpeed * dt);
     }
-    else if (e->key() == Qt::Key_S) {
-        this->cam.translate_up(-0.2);
+    if (input.isDown(Qt::Key_S)) {
+        this->cam.translate_up(-moveSpeed * dt);
     }
-    else if (e->key() == Qt::Key_F) {
-        this->cam.translate_forward(0.2);
+    if (input.isDown(Qt::Key_F)) {
+        this->cam.translate_forward(moveSpeed * dt);
     }
-    else if (e->key() == Qt::Key_B) {
-        this->cam.translate_forward(-0.2);;
+    if (input.isDown(Qt::Key_B)) {
+        this->cam.translate_forward(-moveSpeed * dt);
     }
-    else if (e->key() == Qt::Key_Z) {
-        this->cam.zoom_near(0.1);
+    if (input.isDown(Qt::Key_Z)) {
+        this->cam.zoom_near(zoomSpeed * dt);
     }
-    else if (e->key() == Qt::Key_X) {
-        this->cam.zoom_near(-0.1);
+    if (input.isDown(Qt::Key_X)) {
+        this->cam.zoom_near(-zoomSpeed * dt);
     }
-    else if (e->key() == Qt::Key_T) {
-        this->use_perspective = !this->use_perspective;
-    }
-
-    emit projection_change();
-
-    update();
-}
-
-void CoreFunctionWidget::mousePressEvent(QMouseEvent* e) {
-    mouse_x = e->position().x();
-    mouse_y = e->position().y();
-}
 
-void CoreFunctionWidget::mouseMoveEvent(QMouseEvent* e) {
-    int x = e->position().x();
-    int y = e->position().y();
-
-    if (abs(x - mouse_x) >= 3) {
-        if (x > mouse_x) {
-//            this->cam.rotate_left(3.0);
-            this->cam.rotate_left(-3.0);
-        }
-        else {
-//            this->cam.rotate_left(-3.0);
-            this->cam.rotate_left(3.0);
-        }
-        mouse_x = x;
+    // 本帧内所有鼠标移动合并为一次旋转
+    int dx, dy;
+    input.takeMouseDelta(dx, dy);
+    if (dx != 0) {
+        this->cam.rotate_left(-dx * rotateDegreesPerPixel);
     }
-
-    if (abs(y - mouse_y) >= 3) {
-        if (y > mouse_y) {
-            this->cam.rotate_up(-3.0);
-        }
-        else {
-            this->cam.rotate_up(3.0);
-        }
-
-        mouse_y = y;
+    if (dy != 0) {
+        this->cam.rotate_up(-dy * rotateDegreesPerPixel);
     }
-
-    update();
 }
 
+void CoreFunctionWidget::pickObject(int x, int y) {
+    // 场景包围盒与下标对应的物体名
+    static const char* names[] = { "Cube", "Cube 1", "Cube 2" };
+    // BVH 由推进场景的一方在每步之后更新
+    const Bvh& bvh = follower ? driver->pickBvh : pickBvh;
+
+    // 屏幕坐标 -> NDC，再经投影和相机矩阵的逆变换回世界空间
+    float ndcX = 2.0f * x / width() - 1.0f;
+    float ndcY = 1.0f - 2.0f * y / height();
+    QMatrix4x4 inverse = (projectionMatrix() * this->cam.get_camera_matrix()).inverted();
+    QVector3D nearPoint = (inverse * QVector4D(ndcX, ndcY, -1.0f, 1.0f)).toVector3DAffine();
+    QVector3D farPoint = (inverse * QVector4D(ndcX, ndcY, 1.0f, 1.0f)).toVector3DAffine();
+    QVector3D direction = farPoint - nearPoint;
+    float length = direction.length();
+    direction /= length;
+
+    RayHit hit;
+    if (bvh.raycast(nearPoint, direction, length, hit)) {
+        QString name = hit.object < 3 ? QString(names[hit.object]) : QString("Body %1").arg(hit.object - 2);
+        emit objectPicked(QString("Picked: %1").arg(name));
+    }
+}
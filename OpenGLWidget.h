@@ -10,91 +10,120 @@
 #include <QOpenGLShaderProgram>
 #include <QKeyEvent>
 #include <QTimer>
+#include "AABB.h"
+#include "Bvh.h"
 #include "Camera.h"
-
-struct AABB {
-    QVector3D min;
-    QVector3D max;
-};
-
-enum CollisionFace {
-    NO_COLLISION,
-    COLLISION_X,
-    COLLISION_Y,
-    COLLISION_Z
-};
-
-enum class Filter {
-    None,
-    Invert,
-    Gray
-};
-
-class CoreFunctionWidget : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
+#include "GeometryPool.h"
+#include "FrameCapture.h"
+#include "FrameStats.h"
+#include "GLFunctions.h"
+#include "InputRecorder.h"
+#include "InputState.h"
+#include "RenderThread.h"
+#include "Scene.h"
+#include "SceneRenderer.h"
+#include "SharedResources.h"
+#include <memory>
+
+class CoreFunctionWidget : public QOpenGLWidget, protected GLFunctions
 {
     Q_OBJECT
 public:
-    explicit CoreFunctionWidget(QWidget* parent = nullptr);
+    // driver 非空时为跟随视图：共用 driver 的场景，不自行推进模拟
+    explicit CoreFunctionWidget(QWidget* parent = nullptr, CoreFunctionWidget* driver = nullptr);
     ~CoreFunctionWidget();
 
+    // 多视口中的序号与总数，决定初始观察方位
+    void setViewIndex(int index, int count);
+
+    // 录制输入与时间步长；重放录制文件并与基线逐帧比较耗时
+    void startRecording(const QString& path);
+    void startReplay(const QString& path, const QString& baseline, const QString& timings);
+    void setPerspective(bool perspective);
+    // 把每帧画面异步写入 directory；sceneOnly 时取滤镜前的帧缓冲
+    void startCapture(const QString& directory, CaptureFormat format, bool sceneOnly);
+    // 在独立线程和上下文中推进与绘制，本视图只合成完成的帧；仅单视图且不录制、重放、捕获时生效
+    void setThreadedRendering(bool threaded);
+
 signals:
     void projection_change();
     void collisionDetected(const QString& message);
+    void objectPicked(const QString& message);
 protected:
     virtual void initializeGL();
     virtual void resizeGL(int w, int h);
     virtual void paintGL();
     void keyPressEvent(QKeyEvent* event);
+    void keyReleaseEvent(QKeyEvent* event);
     void mousePressEvent(QMouseEvent* event);
+    void mouseReleaseEvent(QMouseEvent* event);
     void mouseMoveEvent(QMouseEvent* event);
-    int mouse_x, mouse_y;
+    void focusOutEvent(QFocusEvent* event);
+
+    void handleKeyPress(int key);
+    void handleMousePress(int x, int y);
+    void applyFrameInput(float dt);
+    void requestRepaint();
+    void markInput();
+    void onFrameSwapped();
+    void pickObject(int x, int y);
 
 private:
-    void setupShaders();
-    void setupTextures();
-    void setupVertices();
-    void setupCube(GLuint &VAO, GLuint &VBO, float size, QVector3D color);
-    void setupFrameBuffer();
+    QMatrix4x4 projectionMatrix() const;
+    void compositeFrame();
+    void reportStats();
+    void applyInput(const InputEvent& event);
+    void finishReplay();
 
-    GLuint loadCubemap(std::vector<std::string> faces);
     void loadConfig();
-    AABB calculateAABB(const QVector3D& position, float size);
-    CollisionFace checkCollision(const AABB& a, const AABB& b);
-
-    QOpenGLShaderProgram shaderProgram;
-    QOpenGLShaderProgram skyboxShaderProgram;
-    QOpenGLShaderProgram cubeShaderProgram;
-
-    GLuint quadVAO, quadVBO;
-    GLuint fbo, rbo, textureColorBuffer;
-    QOpenGLShaderProgram invertShaderProgram;
-    QOpenGLShaderProgram grayShaderProgram;
+    void loadScene();
 
-    GLuint skyboxVAO, skyboxVBO, skyboxTexture;
+    // 共享的着色器、纹理与几何缓冲；本视图自己的 VAO 与帧缓冲在 renderer 中
+    SharedResources* resources = nullptr;
+    SceneRenderer renderer;
+    RenderSettings settings;
 
-    GLuint cube1VAO, cube1VBO;
-    float cube1Size;
-    QVector3D cube1Position, cube1Rotation, cube1Color;
-    AABB cube1AABB;
+    // 独立渲染线程：场景归渲染线程推进，拾取使用最近合成帧的包围盒
+    bool threadedRendering = false;
+    RenderThread* renderThread = nullptr;
+    GLFramebuffer compositeFbo;
 
-    GLuint cube2VAO, cube2VBO;
-    float cube2Size;
-    QVector3D cube2Position, cube2Rotation, cube2Color;
-    AABB cube2AABB;
+    std::shared_ptr<Scene> scene;
+    std::vector<int> collisionHits;
 
-    GLuint cubeVBO, cubeVAO, texture1, texture2;
-    QVector3D cubePosition, cubeVelocity;
-    AABB cubeAABB;
+    // 多视口：跟随视图记录驱动视图，驱动视图记录所有跟随视图
+    CoreFunctionWidget* driver = nullptr;
+    bool follower = false;
+    std::vector<CoreFunctionWidget*> followers;
+    int viewIndex = 0;
+    float viewAngle = 0.0f;
 
-    GLuint EBO;
-    
     float deltaTime;
     QElapsedTimer timer;
     QTimer updateTimer;
 
-    AABB boundaryAABB;
+    // 拾取：包围盒与 BVH 在场景推进或合成新帧后更新，点击时只查询
+    std::vector<AABB> pickBounds;
+    Bvh pickBvh;
+
+    FrameStats stats;
+    QElapsedTimer statsTimer;
+
+    InputRecorder recorder;
+    QString recordPath, baselinePath, timingsPath;
+    std::vector<float> replayTimings;
+    QElapsedTimer frameTimer;
+
+    FrameCapture capture;
+    QString capturePath;
+    CaptureFormat captureFormat = CaptureFormat::Png;
+    bool captureScene = false;
 
-    Filter currentFilter = Filter::None;
+    InputState input;
+    bool repaintPending = false;
+    QElapsedTimer inputClock;
+    qint64 inputTimestamp = -1;         // 尚未被帧消费的最早输入
+    qint64 frameInputTimestamp = -1;    // 当前帧消费的最早输入
 
     Camera cam;
 public:
@@ -0,0 +1,128 @@
+#include "ParticleSystem.h"
+#include <QDebug>
+#include <QRandomGenerator>
+#include <algorithm>
+
+void ParticleSystem::init(GLFunctions* gl, const ParticleConfig& config, const AABB& bounds, int layerCount) {
+    particleCount = config.count;
+    gpu = config.gpu;
+    currentBuffer = 0;
+    if (particleCount <= 0) {
+        return;
+    }
+
+    // 初始位置在边界内均匀分布，速度方向随机、大小固定；种子固定保证重放一致
+    QRandomGenerator random(config.seed);
+    state.resize(size_t(particleCount) * FLOATS_PER_PARTICLE);
+    QVector3D extent = bounds.max - bounds.min - QVector3D(config.size, config.size, config.size);
+    for (int i = 0; i < particleCount; i++) {
+        float* p = &state[size_t(i) * FLOATS_PER_PARTICLE];
+        QVector3D position = bounds.min + QVector3D(config.size, config.size, config.size) * 0.5f
+                             + QVector3D(random.generateDouble() * extent.x(),
+                                         random.generateDouble() * extent.y(),
+                                         random.generateDouble() * extent.z());
+        QVector3D velocity(random.generateDouble() * 2.0 - 1.0,
+                           random.generateDouble() * 2.0 - 1.0,
+                           random.generateDouble() * 2.0 - 1.0);
+        if (velocity.lengthSquared() < 1e-6f) {
+            velocity = QVector3D(1.0f, 0.0f, 0.0f);
+        }
+        velocity = velocity.normalized() * config.speed;
+        p[0] = position.x();
+        p[1] = position.y();
+        p[2] = position.z();
+        p[3] = config.size;
+        p[4] = velocity.x();
+        p[5] = velocity.y();
+        p[6] = velocity.z();
+        p[7] = float(layerCount > 0 ? i % layerCount : 0);
+    }
+
+    GLsizeiptr bytes = GLsizeiptr(state.size() * sizeof(float));
+    for (int i = 0; i < 2; i++) {
+        buffers[i].create(gl);
+        gl->glBindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+        gl->glBufferData(GL_ARRAY_BUFFER, bytes, i == 0 ? state.data() : nullptr, gpu ? GL_DYNAMIC_COPY : GL_STREAM_DRAW);
+        buffers[i].setBytes(bytes);
+    }
+    gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (!gpu) {
+        return;
+    }
+    state.clear();
+    state.shrink_to_fit();
+
+    // 只有顶点着色器的程序，输出经变换反馈交错写入目标缓冲
+    bool success = updateProgram.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/particles.vert");
+    if (!success) {
+        qDebug() << "updateProgram addShaderFromSourceFile failed!" << updateProgram.log();
+        return;
+    }
+    const char* varyings[] = { "outPosition", "outVelocity" };
+    gl->glTransformFeedbackVaryings(updateProgram.programId(), 2, varyings, GL_INTERLEAVED_ATTRIBS);
+    success = updateProgram.link();
+    if (!success) {
+        qDebug() << "updateProgram link failed!" << updateProgram.log();
+    }
+}
+
+void ParticleSystem::destroy() {
+    buffers[0].reset();
+    buffers[1].reset();
+    particleCount = 0;
+}
+
+void ParticleSystem::update(GLFunctions* gl, GLuint sourceArray, float deltaTime, const AABB& bounds) {
+    if (particleCount <= 0) {
+        return;
+    }
+    if (!gpu) {
+        updateCpu(gl, deltaTime, bounds);
+        return;
+    }
+    if (!updateProgram.isLinked() || !sourceArray) {
+        return;
+    }
+
+    int target = 1 - currentBuffer;
+    gl->glEnable(GL_RASTERIZER_DISCARD);
+    updateProgram.bind();
+    gl->glUniform1f(updateProgram.uniformLocation("deltaTime"), deltaTime);
+    gl->glUniform3f(updateProgram.uniformLocation("boundsMin"), bounds.min.x(), bounds.min.y(), bounds.min.z());
+    gl->glUniform3f(updateProgram.uniformLocation("boundsMax"), bounds.max.x(), bounds.max.y(), bounds.max.z());
+
+    gl->glBindVertexArray(sourceArray);
+    gl->glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, buffers[target]);
+    gl->glBeginTransformFeedback(GL_POINTS);
+    gl->glDrawArrays(GL_POINTS, 0, particleCount);
+    gl->glEndTransformFeedback();
+    gl->glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    gl->glBindVertexArray(0);
+
+    updateProgram.release();
+    gl->glDisable(GL_RASTERIZER_DISCARD);
+    currentBuffer = target;
+}
+
+void ParticleSystem::updateCpu(GLFunctions* gl, float deltaTime, const AABB& bounds) {
+    // 与 particles.vert 相同的积分与反弹规则
+    for (int i = 0; i < particleCount; i++) {
+        float* p = &state[size_t(i) * FLOATS_PER_PARTICLE];
+        float halfSize = p[3] * 0.5f;
+        for (int a = 0; a < 3; a++) {
+            float low = bounds.min[a] + halfSize;
+            float high = bounds.max[a] - halfSize;
+            float position = p[a] + p[4 + a] * deltaTime;
+            float velocity = p[4 + a];
+            if ((position <= low && velocity <= 0.0f) || (position >= high && velocity >= 0.0f)) {
+                velocity = -velocity;
+            }
+            p[a] = std::min(std::max(position, low), high);
+            p[4 + a] = velocity;
+        }
+    }
+    gl->glBindBuffer(GL_ARRAY_BUFFER, buffers[currentBuffer]);
+    gl->glBufferSubData(GL_ARRAY_BUFFER, 0, GLsizeiptr(state.size() * sizeof(float)), state.data());
+    gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
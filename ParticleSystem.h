@@ -0,0 +1,43 @@
+#ifndef PARTICLESYSTEM_H
+#define PARTICLESYSTEM_H
+
+
+#include <QOpenGLShaderProgram>
+#include <vector>
+#include "AABB.h"
+#include "GLFunctions.h"
+#include "GLResource.h"
+#include "Scene.h"
+
+// 在边界内反弹的粒子群，状态在两个 VBO 间交替
+// 每个粒子两个 vec4：(位置, 边长) 和 (速度, 纹理层)，绘制时直接作为实例属性读取
+// GPU 模式用变换反馈从当前缓冲积分写入另一缓冲，全程没有 CPU 回读；CPU 模式逐个积分后整体上传
+class ParticleSystem {
+public:
+    // 粒子的纹理层在 layerCount 层之间轮换
+    void init(GLFunctions* functions, const ParticleConfig& config, const AABB& bounds, int layerCount);
+    void destroy();
+
+    // sourceArray 为读取 buffer(current()) 的状态 VAO，每个上下文各有一套
+    void update(GLFunctions* functions, GLuint sourceArray, float deltaTime, const AABB& bounds);
+
+    int count() const { return particleCount; }
+    bool isGpu() const { return gpu; }
+    int current() const { return currentBuffer; }
+    GLuint buffer(int index) const { return buffers[index]; }
+
+    static const int FLOATS_PER_PARTICLE = 8;
+
+private:
+    void updateCpu(GLFunctions* functions, float deltaTime, const AABB& bounds);
+
+    QOpenGLShaderProgram updateProgram;
+    GLBuffer buffers[2];
+    int currentBuffer = 0;
+    int particleCount = 0;
+    bool gpu = true;
+    std::vector<float> state;   // 仅 CPU 模式使用
+};
+
+
+#endif // PARTICLESYSTEM_H
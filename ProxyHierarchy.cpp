@@ -0,0 +1,147 @@
+#include "ProxyHierarchy.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+void ProxyHierarchy::clear() {
+    nodes.clear();
+    rootCount = 0;
+}
+
+void ProxyHierarchy::build(const std::vector<BoxInstance>& boxes, const ProxyConfig& config, std::vector<int>& order) {
+    clear();
+    order.clear();
+    if (boxes.empty()) {
+        return;
+    }
+
+    // 顶层单元以所有盒子中心的最小值为原点
+    float topSize = config.clusterSize * float(1 << (config.levels - 1));
+    QVector3D origin = boxes[0].position;
+    for (const BoxInstance& box : boxes) {
+        origin = QVector3D(std::min(origin.x(), box.position.x()),
+                           std::min(origin.y(), box.position.y()),
+                           std::min(origin.z(), box.position.z()));
+    }
+    std::map<std::array<int, 3>, std::vector<int>> cells;
+    for (int i = 0; i < int(boxes.size()); i++) {
+        QVector3D cell = (boxes[i].position - origin) / topSize;
+        cells[{ int(std::floor(cell.x())), int(std::floor(cell.y())), int(std::floor(cell.z())) }].push_back(i);
+    }
+
+    rootCount = int(cells.size());
+    nodes.resize(rootCount);
+    int index = 0;
+    for (const auto& cell : cells) {
+        nodes[index].cellMin = origin + QVector3D(cell.first[0], cell.first[1], cell.first[2]) * topSize;
+        nodes[index].cellSize = topSize;
+        index++;
+    }
+    index = 0;
+    for (const auto& cell : cells) {
+        split(index++, cell.second, config.levels - 1, boxes, order);
+    }
+}
+
+void ProxyHierarchy::split(int node, const std::vector<int>& members, int level, const std::vector<BoxInstance>& boxes, std::vector<int>& order) {
+    AABB bounds = Scene::calculateAABB(boxes[members[0]].position, boxes[members[0]].size);
+    for (int member : members) {
+        AABB box = Scene::calculateAABB(boxes[member].position, boxes[member].size);
+        bounds.min = QVector3D(std::min(bounds.min.x(), box.min.x()),
+                               std::min(bounds.min.y(), box.min.y()),
+                               std::min(bounds.min.z(), box.min.z()));
+        bounds.max = QVector3D(std::max(bounds.max.x(), box.max.x()),
+                               std::max(bounds.max.y(), box.max.y()),
+                               std::max(bounds.max.z(), box.max.z()));
+    }
+    nodes[node].bounds = bounds;
+    nodes[node].firstInstance = int(order.size());
+
+    if (level == 0) {
+        order.insert(order.end(), members.begin(), members.end());
+    } else {
+        // 按盒子中心落在哪个八分体分组，空的八分体不建子簇
+        QVector3D cellMin = nodes[node].cellMin;
+        float half = nodes[node].cellSize * 0.5f;
+        QVector3D middle = cellMin + QVector3D(half, half, half);
+        std::vector<int> octants[8];
+        for (int member : members) {
+            const QVector3D& p = boxes[member].position;
+            int octant = (p.x() >= middle.x() ? 1 : 0) | (p.y() >= middle.y() ? 2 : 0) | (p.z() >= middle.z() ? 4 : 0);
+            octants[octant].push_back(member);
+        }
+        int firstChild = int(nodes.size());
+        int childCount = 0;
+        for (int octant = 0; octant < 8; octant++) {
+            if (octants[octant].empty()) {
+                continue;
+            }
+            ProxyNode child;
+            child.cellMin = cellMin + QVector3D(octant & 1 ? half : 0.0f, octant & 2 ? half : 0.0f, octant & 4 ? half : 0.0f);
+            child.cellSize = half;
+            nodes.push_back(child);
+            childCount++;
+        }
+        nodes[node].firstChild = firstChild;
+        nodes[node].childCount = childCount;
+        int child = firstChild;
+        for (int octant = 0; octant < 8; octant++) {
+            if (!octants[octant].empty()) {
+                split(child++, octants[octant], level - 1, boxes, order);
+            }
+        }
+    }
+    nodes[node].instanceCount = int(order.size()) - nodes[node].firstInstance;
+}
+
+MeshData ProxyHierarchy::proxyMesh(int node, const std::vector<BoxInstance>& boxes, const std::vector<int>& order,
+                                   const std::vector<QVector3D>& layerColors) const {
+    const ProxyNode& cluster = nodes[node];
+    float half = cluster.cellSize * 0.5f;
+    AABB cells[8];
+    QVector3D colors[8];
+    int counts[8] = {};
+    for (int i = cluster.firstInstance; i < cluster.firstInstance + cluster.instanceCount; i++) {
+        const BoxInstance& box = boxes[order[i]];
+        QVector3D local = (box.position - cluster.cellMin) / half;
+        int cell = (local.x() >= 1.0f ? 1 : 0) | (local.y() >= 1.0f ? 2 : 0) | (local.z() >= 1.0f ? 4 : 0);
+        AABB bounds = Scene::calculateAABB(box.position, box.size);
+        if (counts[cell] == 0) {
+            cells[cell] = bounds;
+        } else {
+            cells[cell].min = QVector3D(std::min(cells[cell].min.x(), bounds.min.x()),
+                                        std::min(cells[cell].min.y(), bounds.min.y()),
+                                        std::min(cells[cell].min.z(), bounds.min.z()));
+            cells[cell].max = QVector3D(std::max(cells[cell].max.x(), bounds.max.x()),
+                                        std::max(cells[cell].max.y(), bounds.max.y()),
+                                        std::max(cells[cell].max.z(), bounds.max.z()));
+        }
+        colors[cell] += layerColors[box.layer];
+        counts[cell]++;
+    }
+
+    // 单位立方体按格的包围盒缩放平移，直接写成世界坐标
+    MeshData mesh;
+    mesh.format = VertexFormat::Pos3Color3;
+    for (int cell = 0; cell < 8; cell++) {
+        if (counts[cell] == 0) {
+            continue;
+        }
+        MeshData cube = MeshLibrary::box(1.0f, colors[cell] / float(counts[cell]));
+        QVector3D center = (cells[cell].min + cells[cell].max) * 0.5f;
+        QVector3D extent = cells[cell].max - cells[cell].min;
+        GLuint base = GLuint(mesh.vertexCount());
+        for (int i = 0; i < cube.vertexCount(); i++) {
+            float* vertex = &cube.vertices[i * 6];
+            QVector3D p = center + QVector3D(vertex[0], vertex[1], vertex[2]) * extent;
+            vertex[0] = p.x();
+            vertex[1] = p.y();
+            vertex[2] = p.z();
+        }
+        mesh.vertices.insert(mesh.vertices.end(), cube.vertices.begin(), cube.vertices.end());
+        for (GLuint index : cube.indices) {
+            mesh.indices.push_back(base + index);
+        }
+    }
+    return mesh;
+}
@@ -0,0 +1,49 @@
+#ifndef PROXYHIERARCHY_H
+#define PROXYHIERARCHY_H
+
+
+#include <QVector3D>
+#include <vector>
+#include "AABB.h"
+#include "GeometryPool.h"
+#include "MeshLibrary.h"
+#include "Scene.h"
+
+// 一个簇：所在的网格单元、包围盒、子簇和簇内盒子在排序后实例数据中的范围
+struct ProxyNode {
+    QVector3D cellMin;
+    float cellSize = 0.0f;
+    AABB bounds;
+    int firstChild = -1;    // 子簇在 nodes 中连续存放
+    int childCount = 0;
+    int firstInstance = 0;
+    int instanceCount = 0;
+    MeshRange proxy;        // 合并后的代理网格，顶点为世界坐标
+
+    bool isLeaf() const { return childCount == 0; }
+};
+
+// 静态盒子的层次代理：顶层按 clusterSize * 2^(levels-1) 见方分组，每层按八分体细分到 clusterSize
+// 叶簇按深度优先顺序排列盒子，任一簇内的盒子在实例数据中都是连续的一段
+class ProxyHierarchy {
+public:
+    // order 返回排列后每个位置对应的盒子下标，实例数据应按此顺序上传
+    void build(const std::vector<BoxInstance>& boxes, const ProxyConfig& config, std::vector<int>& order);
+    void clear();
+
+    // 簇按每轴两格划分，格内的盒子合并为一个包住它们的立方体，颜色取各盒子纹理层平均色的均值
+    MeshData proxyMesh(int node, const std::vector<BoxInstance>& boxes, const std::vector<int>& order,
+                       const std::vector<QVector3D>& layerColors) const;
+
+    bool isEmpty() const { return nodes.empty(); }
+
+    // 前 rootCount 个为顶层簇
+    std::vector<ProxyNode> nodes;
+    int rootCount = 0;
+
+private:
+    void split(int node, const std::vector<int>& members, int level, const std::vector<BoxInstance>& boxes, std::vector<int>& order);
+};
+
+
+#endif // PROXYHIERARCHY_H
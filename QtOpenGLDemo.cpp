@@ -1,5 +1,6 @@
 #include "QtOpenGLDemo.h"
 #include "ui_QtOpenGLDemo.h"
+#include <cmath>
 
 QtOpenGLDemo::QtOpenGLDemo(QWidget *parent)
     : QWidget(parent)
@@ -14,6 +15,29 @@ QtOpenGLDemo::QtOpenGLDemo(QWidget *parent)
     connect(this->ui->orthoButton, SIGNAL(clicked()), this, SLOT(set_ortho()));
     connect(this->core_widget, SIGNAL(projection_change()), this, SLOT(set_projection_button()));
     connect(this->core_widget, SIGNAL(collisionDetected(const QString&)), this, SLOT(updateCollisionInfo(const QString&)));
+    connect(this->core_widget, SIGNAL(objectPicked(const QString&)), this, SLOT(updateCollisionInfo(const QString&)));
+}
+
+void QtOpenGLDemo::setViewCount(int count) {
+    if (count <= 1) {
+        return;
+    }
+
+    // 原来的绘制区域划分为网格，左上角为驱动视图，其余为跟随视图
+    const int area = 700;
+    int columns = int(std::ceil(std::sqrt(double(count))));
+    int rows = (count + columns - 1) / columns;
+    int cellWidth = area / columns;
+    int cellHeight = area / rows;
+
+    core_widget->setGeometry(QRect(0, 0, cellWidth, cellHeight));
+    core_widget->setViewIndex(0, count);
+    for (int i = 1; i < count; i++) {
+        CoreFunctionWidget* view = new CoreFunctionWidget(this, core_widget);
+        view->setGeometry(QRect((i % columns) * cellWidth, (i / columns) * cellHeight, cellWidth, cellHeight));
+        view->setViewIndex(i, count);
+        connect(view, SIGNAL(objectPicked(const QString&)), this, SLOT(updateCollisionInfo(const QString&)));
+    }
 }
 
 QtOpenGLDemo::~QtOpenGLDemo()
@@ -31,13 +55,11 @@ void QtOpenGLDemo::set_projection_button() {
 }
 
 void QtOpenGLDemo::set_ortho() {
-    this->core_widget->use_perspective = false;
-    this->core_widget->update();
+    this->core_widget->setPerspective(false);
 }
 
 void QtOpenGLDemo::set_persective() {
-    this->core_widget->use_perspective = true;
-    this->core_widget->update();
+    this->core_widget->setPerspective(true);
 }
 
 void QtOpenGLDemo::updateCollisionInfo(const QString& message) {
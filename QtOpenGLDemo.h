@@ -16,6 +16,10 @@ public:
     QtOpenGLDemo(QWidget *parent = nullptr);
     ~QtOpenGLDemo();
 
+    CoreFunctionWidget* glWidget() const { return core_widget; }
+    // 多视口：同一场景按网格排列 count 个视图，需在显示前调用
+    void setViewCount(int count);
+
 public slots:
     void set_ortho();
     void set_persective();
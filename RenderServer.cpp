@@ -0,0 +1,383 @@
+#include "RenderServer.h"
+#include <QBuffer>
+#include <QDebug>
+#include <QFile>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSurfaceFormat>
+#include <QTimer>
+#include <algorithm>
+#include "Metrics.h"
+
+namespace {
+
+// 读取 [x, y, z] 形式的向量，缺省时保留原值
+bool readVector(const QJsonObject& json, const QString& key, QVector3D& value) {
+    if (!json.contains(key)) {
+        return true;
+    }
+    QJsonArray array = json[key].toArray();
+    if (array.size() != 3) {
+        return false;
+    }
+    value = QVector3D(array[0].toDouble(), array[1].toDouble(), array[2].toDouble());
+    return true;
+}
+
+}
+
+RenderServer::RenderServer(QObject* parent)
+    : QObject(parent)
+{
+    connect(&server, &QLocalServer::newConnection, this, &RenderServer::acceptConnections);
+}
+
+RenderServer::~RenderServer() {
+    if (!ready) {
+        return;
+    }
+    context->makeCurrent(surface);
+    releaseScene();
+    targetFbo.reset();
+    targetColor.reset();
+    targetDepth.reset();
+    context->doneCurrent();
+}
+
+bool RenderServer::start(const QString& name) {
+    QSurfaceFormat format = QSurfaceFormat::defaultFormat();
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    context = new QOpenGLContext(this);
+    context->setFormat(format);
+    if (!context->create()) {
+        qDebug() << "RenderServer failed to create a context!";
+        return false;
+    }
+    surface = new QOffscreenSurface(nullptr, this);
+    surface->setFormat(context->format());
+    surface->create();
+    if (!context->makeCurrent(surface) || !gl.initializeOpenGLFunctions()) {
+        qDebug() << "RenderServer needs an OpenGL 3.3 core context!";
+        return false;
+    }
+#ifdef GL_TRACE
+    gl.startValidation();
+#endif
+    ready = true;
+
+    // 先载入内置配置，首个请求不必等待着色器编译和纹理加载
+    if (!switchScene(QString())) {
+        return false;
+    }
+
+    QLocalServer::removeServer(name);
+    if (!server.listen(name)) {
+        qDebug() << "RenderServer failed to listen!" << name << server.errorString();
+        return false;
+    }
+    clock.start();
+    qDebug().noquote() << QString("render server: listening on %1").arg(server.fullServerName());
+    return true;
+}
+
+void RenderServer::acceptConnections() {
+    while (server.hasPendingConnections()) {
+        QLocalSocket* socket = server.nextPendingConnection();
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { readRequests(socket); });
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+    }
+}
+
+void RenderServer::readRequests(QLocalSocket* socket) {
+    while (socket->canReadLine()) {
+        QByteArray line = socket->readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        RenderRequest request;
+        request.socket = socket;
+        request.received = clock.nsecsElapsed();
+        QString error;
+        if (!parseRequest(line, request, error)) {
+            replyError(socket, request.id, error);
+            continue;
+        }
+        queue.push_back(request);
+    }
+    scheduleBatch();
+}
+
+bool RenderServer::parseRequest(const QByteArray& line, RenderRequest& request, QString& error) {
+    QJsonDocument doc = QJsonDocument::fromJson(line);
+    if (!doc.isObject()) {
+        error = "request is not a JSON object";
+        return false;
+    }
+    QJsonObject json = doc.object();
+    request.id = qint64(json["id"].toDouble());
+    request.config = json["config"].toString();
+
+    if (!readVector(json, "eye", request.eye) || !readVector(json, "target", request.target)
+        || !readVector(json, "up", request.up)) {
+        error = "eye, target and up must be [x, y, z]";
+        return false;
+    }
+    if ((request.target - request.eye).lengthSquared() < 1e-8f) {
+        error = "eye and target coincide";
+        return false;
+    }
+    request.fov = std::clamp(float(json["fov"].toDouble(request.fov)), 1.0f, 179.0f);
+
+    if (json.contains("filter")) {
+        QString filter = json["filter"].toString();
+        request.hasFilter = true;
+        if (filter == "none") {
+            request.filter = Filter::None;
+        } else if (filter == "gray") {
+            request.filter = Filter::Gray;
+        } else if (filter == "invert") {
+            request.filter = Filter::Invert;
+        } else {
+            error = "unknown filter " + filter;
+            return false;
+        }
+    }
+
+    request.width = json["width"].toInt(request.width);
+    request.height = json["height"].toInt(request.height);
+    if (request.width < 1 || request.height < 1 || request.width > 4096 || request.height > 4096) {
+        error = "width and height must be within 1..4096";
+        return false;
+    }
+
+    QString format = json["format"].toString();
+    if (format.isEmpty() || format == "png") {
+        request.png = true;
+    } else if (format == "raw") {
+        request.png = false;
+    } else {
+        error = "unknown format " + format;
+        return false;
+    }
+    return true;
+}
+
+void RenderServer::scheduleBatch() {
+    // 推迟到事件循环空闲时处理，同时到达的请求合并为一批
+    if (batchScheduled || queue.empty()) {
+        return;
+    }
+    batchScheduled = true;
+    QTimer::singleShot(0, this, [this]() { processBatch(); });
+}
+
+void RenderServer::processBatch() {
+    batchScheduled = false;
+    if (queue.empty()) {
+        return;
+    }
+    QElapsedTimer batchTimer;
+    batchTimer.start();
+
+    // 优先处理与常驻场景同配置的请求，没有时才切换到最早请求的配置
+    QString config = sceneConfig;
+    bool resident = scene && std::any_of(queue.begin(), queue.end(),
+                                         [&](const RenderRequest& request) { return request.config == sceneConfig; });
+    if (!resident) {
+        config = queue.front().config;
+    }
+    context->makeCurrent(surface);
+    bool loaded = resident || switchScene(config);
+
+    std::deque<RenderRequest> pending;
+    int count = 0;
+    double batchLatencySum = 0.0;
+    double batchLatencyMax = 0.0;
+    frameStats.reset();
+    for (RenderRequest& request : queue) {
+        if (request.config != config) {
+            pending.push_back(request);
+            continue;
+        }
+        if (!request.socket) {
+            continue;   // 客户端已断开
+        }
+        if (!loaded) {
+            replyError(request.socket, request.id, "failed to load config " + config);
+            continue;
+        }
+
+        QByteArray payload = render(request);
+        double latency = (clock.nsecsElapsed() - request.received) / 1000000.0;
+        QJsonObject header;
+        header["id"] = double(request.id);
+        header["ok"] = true;
+        header["width"] = request.width;
+        header["height"] = request.height;
+        header["format"] = request.png ? "png" : "raw";
+        header["bytes"] = payload.size();
+        header["ms"] = latency;
+        reply(request, QJsonDocument(header).toJson(QJsonDocument::Compact), payload);
+        Metrics::recordServerRequest(latency);
+
+        count++;
+        batchLatencySum += latency;
+        batchLatencyMax = std::max(batchLatencyMax, latency);
+    }
+    queue.swap(pending);
+    qint64 batchNs = batchTimer.nsecsElapsed();
+    busyNs += batchNs;
+    Metrics::recordServerBatch(batchNs / 1000000.0);
+
+    // 吞吐量总是报告，只有 GL 对象清单随 render.logStats 输出
+    if (count > 0) {
+        served += count;
+        latencySum += batchLatencySum;
+        latencyMax = std::max(latencyMax, batchLatencyMax);
+        qDebug().noquote() << QString("render server: batch of %1 (%2), latency avg %3 ms max %4 ms; "
+                                      "%5 served, %6 req/s while busy, %7 scene switches")
+                                  .arg(count)
+                                  .arg(config.isEmpty() ? QString("built-in config") : config)
+                                  .arg(batchLatencySum / count, 0, 'f', 2)
+                                  .arg(batchLatencyMax, 0, 'f', 2)
+                                  .arg(served)
+                                  .arg(served / (busyNs / 1000000000.0), 0, 'f', 1)
+                                  .arg(sceneSwitches);
+    }
+    if (count > 0 && scene && scene->logStats) {
+        // 换配置时共享资源整体重建，对象数与显存应保持不变
+        qDebug().noquote() << "render server: " + GLResourceRegistry::report();
+    }
+    // 其余配置的请求留到下一批
+    scheduleBatch();
+}
+
+bool RenderServer::switchScene(const QString& config) {
+    QFile file(config.isEmpty() ? ":/config.json" : config);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qDebug() << "Failed to open config file!" << config;
+        return false;
+    }
+    std::unique_ptr<Scene> next = std::make_unique<Scene>();
+    if (!next->load(file.readAll())) {
+        qDebug() << "Failed to load config file!" << config;
+        return false;
+    }
+
+    // 共享资源按场景构建，换配置时整体重建
+    releaseScene();
+    scene = std::move(next);
+    resources = SharedResources::acquire(&gl, *scene);
+    renderer.init(resources, scene->framesInFlight, std::max(targetWidth, 1), std::max(targetHeight, 1));
+#ifdef GL_TRACE
+    renderer.shareValidation(gl);
+#endif
+    sceneConfig = config;
+    sceneSwitches++;
+    return true;
+}
+
+void RenderServer::releaseScene() {
+    if (!resources) {
+        return;
+    }
+    renderer.destroy();
+    SharedResources::release(&gl);
+    resources = nullptr;
+    scene.reset();
+    sceneConfig.clear();
+}
+
+QByteArray RenderServer::render(const RenderRequest& request) {
+    int w = request.width;
+    int h = request.height;
+    setupTarget(w, h);
+    if (renderer.width() != w || renderer.height() != h) {
+        renderer.resize(w, h);
+    }
+
+    QMatrix4x4 view;
+    view.lookAt(request.eye, request.target, request.up);
+    QMatrix4x4 projection;
+    projection.perspective(request.fov, float(w) / float(h), 0.01f, 50.0f);
+
+    // 重绘统计需要逐帧回读，服务模式下不开启
+    RenderSettings settings;
+    settings.filter = request.hasFilter ? request.filter : scene->filter;
+    settings.depthPrepass = scene->depthPrepass;
+    settings.overdraw = false;
+    settings.occlusion = scene->occlusion;
+    settings.streamBlocking = true;
+    // 每个请求是独立的一帧，上一请求的块可以被淘汰
+    resources->streaming.beginFrame();
+    renderer.render(*scene, view, projection, settings, targetFbo, frameStats);
+
+    pixels.resize(size_t(w) * h * 4);
+    gl.glBindFramebuffer(GL_FRAMEBUFFER, targetFbo);
+    gl.glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    gl.glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    gl.glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (!request.png) {
+        return QByteArray(reinterpret_cast<const char*>(pixels.data()), int(pixels.size()));
+    }
+    QImage image(pixels.data(), w, h, QImage::Format_RGBA8888);
+    QByteArray bytes;
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::WriteOnly);
+    image.mirrored().save(&buffer, "PNG");
+    return bytes;
+}
+
+void RenderServer::setupTarget(int width, int height) {
+    if (targetFbo && width == targetWidth && height == targetHeight) {
+        return;
+    }
+    if (!targetFbo) {
+        targetFbo.create(&gl);
+        targetColor.create(&gl);
+        targetDepth.create(&gl);
+    }
+    targetWidth = width;
+    targetHeight = height;
+
+    gl.glBindTexture(GL_TEXTURE_2D, targetColor);
+    gl.glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    targetColor.setBytes(GLResourceRegistry::imageBytes(width, height));
+    gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    gl.glBindTexture(GL_TEXTURE_2D, 0);
+    gl.glBindRenderbuffer(GL_RENDERBUFFER, targetDepth);
+    gl.glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    targetDepth.setBytes(GLResourceRegistry::imageBytes(width, height));
+    gl.glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    gl.glBindFramebuffer(GL_FRAMEBUFFER, targetFbo);
+    gl.glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, targetColor, 0);
+    gl.glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, targetDepth);
+    if (gl.glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        qDebug() << "RenderServer framebuffer is not complete!";
+    }
+    gl.glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderServer::reply(const RenderRequest& request, const QByteArray& header, const QByteArray& payload) {
+    request.socket->write(header);
+    request.socket->write("\n");
+    request.socket->write(payload);
+}
+
+void RenderServer::replyError(QLocalSocket* socket, qint64 id, const QString& error) {
+    if (!socket) {
+        return;
+    }
+    QJsonObject header;
+    header["id"] = double(id);
+    header["ok"] = false;
+    header["error"] = error;
+    socket->write(QJsonDocument(header).toJson(QJsonDocument::Compact));
+    socket->write("\n");
+}
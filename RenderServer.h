@@ -0,0 +1,95 @@
+#ifndef RENDERSERVER_H
+#define RENDERSERVER_H
+
+
+#include <QElapsedTimer>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QPointer>
+#include <QVector3D>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "FrameStats.h"
+#include "GLFunctions.h"
+#include "GLResource.h"
+#include "Scene.h"
+#include "SceneRenderer.h"
+#include "SharedResources.h"
+
+// 一次离屏渲染请求，对应客户端发来的一行 JSON
+struct RenderRequest {
+    QPointer<QLocalSocket> socket;
+    qint64 id = 0;
+    QString config;             // 场景配置文件路径，默认使用内置配置
+    QVector3D eye = QVector3D(0.0f, 0.0f, 8.0f);
+    QVector3D target;
+    QVector3D up = QVector3D(0.0f, 1.0f, 0.0f);
+    float fov = 90.0f;
+    bool hasFilter = false;     // 未指定时沿用配置中的滤镜
+    Filter filter = Filter::None;
+    int width = 256;
+    int height = 256;
+    bool png = true;            // 否则返回自下而上的 RGBA 原始像素
+    qint64 received = 0;        // 收到请求的时刻（纳秒）
+};
+
+// 无窗口的渲染服务：上下文与着色器、纹理、几何只初始化一次，
+// 经 QLocalServer 接收请求，按场景配置成批离屏渲染并返回图像
+class RenderServer : public QObject {
+    Q_OBJECT
+public:
+    explicit RenderServer(QObject* parent = nullptr);
+    ~RenderServer();
+
+    bool start(const QString& name);
+
+private:
+    void acceptConnections();
+    void readRequests(QLocalSocket* socket);
+    bool parseRequest(const QByteArray& line, RenderRequest& request, QString& error);
+    void scheduleBatch();
+    void processBatch();
+    bool switchScene(const QString& config);
+    void releaseScene();
+    QByteArray render(const RenderRequest& request);
+    void setupTarget(int width, int height);
+    void reply(const RenderRequest& request, const QByteArray& header, const QByteArray& payload);
+    void replyError(QLocalSocket* socket, qint64 id, const QString& error);
+
+    QLocalServer server;
+    QOpenGLContext* context = nullptr;
+    QOffscreenSurface* surface = nullptr;
+    GLFunctions gl;
+    bool ready = false;
+
+    // 当前常驻的场景：请求按配置分组，同一配置的请求连续渲染，切换时才重建共享资源
+    QString sceneConfig;
+    std::unique_ptr<Scene> scene;
+    SharedResources* resources = nullptr;
+    SceneRenderer renderer;
+    FrameStats frameStats;
+
+    // 离屏目标按请求尺寸重建
+    GLFramebuffer targetFbo;
+    GLTexture targetColor;
+    GLRenderbuffer targetDepth;
+    int targetWidth = 0, targetHeight = 0;
+    std::vector<uchar> pixels;
+
+    std::deque<RenderRequest> queue;
+    bool batchScheduled = false;
+    QElapsedTimer clock;
+
+    // 累计统计，每批输出一次
+    int served = 0;
+    int sceneSwitches = 0;
+    double latencySum = 0.0;
+    double latencyMax = 0.0;
+    qint64 busyNs = 0;
+};
+
+
+#endif // RENDERSERVER_H
@@ -0,0 +1,255 @@
+#include "RenderThread.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <algorithm>
+#include "Metrics.h"
+
+RenderThread::RenderThread(QOpenGLContext* shareContext, std::shared_ptr<Scene> scene, SharedResources* resources, QObject* parent)
+    : QThread(parent), scene(std::move(scene)), resources(resources)
+{
+    // 上下文与离屏表面都在 GUI 线程创建，上下文随后交给渲染线程
+    context = new QOpenGLContext();
+    context->setFormat(shareContext->format());
+    context->setShareContext(shareContext);
+    if (!context->create()) {
+        qDebug() << "RenderThread failed to create a shared context!";
+    }
+    surface = new QOffscreenSurface();
+    surface->setFormat(context->format());
+    surface->create();
+    context->moveToThread(this);
+    running = true;
+}
+
+RenderThread::~RenderThread() {
+    stop();
+    delete context;
+    delete surface;
+}
+
+void RenderThread::stop() {
+    running = false;
+    wait();
+}
+
+void RenderThread::publishView(const ViewSnapshot& snapshot) {
+    views.back() = snapshot;
+    views.publish();
+}
+
+bool RenderThread::takeFrame(GLFunctions* functions) {
+    if (!frames.update()) {
+        return false;
+    }
+    // 在 GPU 上等渲染线程的命令完成，不阻塞 GUI 线程
+    PresentedFrame& presented = frames.front();
+    if (presented.fence) {
+        functions->glWaitSync(presented.fence, 0, GL_TIMEOUT_IGNORED);
+        functions->glDeleteSync(presented.fence);
+        presented.fence = nullptr;
+    }
+    return true;
+}
+
+void RenderThread::finishRead(GLFunctions* functions) {
+    GLsync fence = functions->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    functions->glFlush();
+    // 同一帧被合成多次时只保留最后一次读取的 fence
+    GLsync previous = readFences[frames.frontSlot()].exchange(fence);
+    if (previous) {
+        functions->glDeleteSync(previous);
+    }
+}
+
+void RenderThread::run() {
+    context->makeCurrent(surface);
+
+    // 收到第一份相机快照后才知道输出尺寸
+    while (running && !views.update()) {
+        QThread::msleep(1);
+    }
+    if (running) {
+        init();
+    }
+
+    // 按固定节拍推进与绘制，GUI 线程繁忙时只影响合成，不影响出帧
+    const qint64 frameNs = 1000000000 / 60;
+    QElapsedTimer clock;
+    clock.start();
+    QElapsedTimer statsTimer;
+    statsTimer.start();
+    qint64 lastFrame = clock.nsecsElapsed();
+    qint64 nextFrame = lastFrame;
+    while (running) {
+        views.update();
+        qint64 now = clock.nsecsElapsed();
+        double interval = (now - lastFrame) / 1000000.0;
+        lastFrame = now;
+        stats.frameIntervalSum += interval;
+        stats.frameIntervalMax = std::max(stats.frameIntervalMax, interval);
+        stats.frameIntervalSamples++;
+
+        renderFrame(views.front(), float(interval / 1000.0));
+
+        if (statsTimer.elapsed() >= 1000) {
+            reportStats(statsTimer.restart() / 1000.0);
+        }
+
+        nextFrame += frameNs;
+        qint64 remaining = nextFrame - clock.nsecsElapsed();
+        if (remaining > 0) {
+            QThread::usleep(remaining / 1000);
+        } else {
+            // 落后时不追帧，从当前时刻重新计时
+            nextFrame = clock.nsecsElapsed();
+        }
+    }
+
+    destroy();
+    context->doneCurrent();
+    context->moveToThread(QCoreApplication::instance()->thread());
+}
+
+void RenderThread::init() {
+    gl.initializeOpenGLFunctions();
+    const ViewSnapshot& snapshot = views.front();
+    renderer.init(resources, scene->framesInFlight, snapshot.width, snapshot.height);
+#ifdef GL_TRACE
+    gl.startValidation();
+    renderer.shareValidation(gl);
+#endif
+
+    depthStencil.create(&gl);
+    for (int slot = 0; slot < 3; slot++) {
+        outputTextures[slot].create(&gl);
+        outputFbos[slot].create(&gl);
+        gl.glBindTexture(GL_TEXTURE_2D, outputTextures[slot]);
+        gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        gl.glBindFramebuffer(GL_FRAMEBUFFER, outputFbos[slot]);
+        gl.glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, outputTextures[slot], 0);
+        gl.glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthStencil);
+    }
+    gl.glBindTexture(GL_TEXTURE_2D, 0);
+    gl.glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    qDebug().noquote() << QString("render thread: own context, %1x%2 output x3").arg(snapshot.width).arg(snapshot.height);
+}
+
+void RenderThread::destroy() {
+    if (!depthStencil) {
+        return;
+    }
+    // 尚未被 GUI 线程取走的帧与读取 fence 一并删除
+    gl.glFinish();
+    if (frames.back().fence) {
+        gl.glDeleteSync(frames.back().fence);
+        frames.back().fence = nullptr;
+    }
+    for (std::atomic<GLsync>& readFence : readFences) {
+        GLsync fence = readFence.exchange(nullptr);
+        if (fence) {
+            gl.glDeleteSync(fence);
+        }
+    }
+    renderer.destroy();
+    for (int slot = 0; slot < 3; slot++) {
+        outputFbos[slot].reset();
+        outputTextures[slot].reset();
+    }
+    depthStencil.reset();
+}
+
+void RenderThread::renderFrame(const ViewSnapshot& snapshot, float deltaTime) {
+    QElapsedTimer frameTimer;
+    frameTimer.start();
+    resources->streaming.beginFrame();
+    QElapsedTimer physicsTimer;
+    physicsTimer.start();
+    scene->step(deltaTime, collisionHits);
+    double physicsMs = physicsTimer.nsecsElapsed() / 1000000.0;
+    stats.physicsMsSum += physicsMs;
+    stats.physicsSamples++;
+    Metrics::recordPhysics(physicsMs, int(collisionHits.size()));
+    for (int hit : collisionHits) {
+        emit collisionDetected(QString("Cube: %1!").arg(hit));
+    }
+    renderer.updateParticles(deltaTime, scene->boundaryAABB, stats);
+
+    // 上次发布后未被取走的帧直接覆盖；GUI 线程读过的槽先在 GPU 上等读取完成
+    int slot = frames.backSlot();
+    PresentedFrame& frame = frames.back();
+    if (frame.fence) {
+        gl.glDeleteSync(frame.fence);
+        frame.fence = nullptr;
+    }
+    GLsync readFence = readFences[slot].exchange(nullptr);
+    if (readFence) {
+        gl.glWaitSync(readFence, 0, GL_TIMEOUT_IGNORED);
+        gl.glDeleteSync(readFence);
+    }
+
+    setupOutput(slot, snapshot.width, snapshot.height);
+    renderer.resize(snapshot.width, snapshot.height);
+    int drawCallsBefore = stats.drawCalls;
+    int culledBefore = stats.frustumCulled + stats.occlusionCulled;
+    renderer.render(*scene, snapshot.view, snapshot.projection, snapshot.settings, outputFbos[slot], stats);
+
+    // fence 需先提交，GUI 上下文才能等待它
+    frame.fence = gl.glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    gl.glFlush();
+    frame.width = snapshot.width;
+    frame.height = snapshot.height;
+    scene->bounds(frame.bounds);
+    frames.publish();
+    Metrics::recordFrame(deltaTime * 1000.0, frameTimer.nsecsElapsed() / 1000000.0, stats.drawCalls - drawCallsBefore,
+                         stats.frustumCulled + stats.occlusionCulled - culledBefore);
+    stats.frames++;
+    emit frameReady();
+}
+
+void RenderThread::setupOutput(int slot, int width, int height) {
+    if (depthWidth != width || depthHeight != height) {
+        gl.glBindRenderbuffer(GL_RENDERBUFFER, depthStencil);
+        gl.glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        gl.glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        depthStencil.setBytes(GLResourceRegistry::imageBytes(width, height));
+        depthWidth = width;
+        depthHeight = height;
+    }
+    if (outputWidths[slot] == width && outputHeights[slot] == height) {
+        return;
+    }
+    // 窗口尺寸变化后各槽在下次使用时才重新分配
+    gl.glBindTexture(GL_TEXTURE_2D, outputTextures[slot]);
+    gl.glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    gl.glBindTexture(GL_TEXTURE_2D, 0);
+    outputTextures[slot].setBytes(GLResourceRegistry::imageBytes(width, height));
+    outputWidths[slot] = width;
+    outputHeights[slot] = height;
+
+    gl.glBindFramebuffer(GL_FRAMEBUFFER, outputFbos[slot]);
+    if (gl.glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        qDebug() << "ERROR::FRAMEBUFFER:: Render thread output is not complete!";
+    }
+    gl.glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderThread::reportStats(double seconds) {
+    if (scene->logStats) {
+#ifdef GL_TRACE
+        // 场景绘制的调用记在 renderer 上，输出帧缓冲与同步的调用记在本线程的函数表上
+        GLCallCounts calls = renderer.callCounts();
+        calls += gl.callCounts();
+        QString message = stats.format(seconds, *resources, *scene, renderer.framesInFlight(), &calls);
+#else
+        QString message = stats.format(seconds, *resources, *scene, renderer.framesInFlight());
+#endif
+        qDebug().noquote() << "render thread: " + message;
+    }
+#ifdef GL_TRACE
+    renderer.callCounts().reset();
+    gl.callCounts().reset();
+#endif
+    stats.reset();
+}
@@ -0,0 +1,93 @@
+#ifndef RENDERTHREAD_H
+#define RENDERTHREAD_H
+
+
+#include <QMatrix4x4>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QThread>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "AABB.h"
+#include "FrameStats.h"
+#include "GLResource.h"
+#include "SceneRenderer.h"
+#include "TripleBuffer.h"
+
+// GUI 线程每帧发布的相机与绘制选项
+struct ViewSnapshot {
+    QMatrix4x4 view;
+    QMatrix4x4 projection;
+    RenderSettings settings;
+    int width = 0;
+    int height = 0;
+};
+
+// 渲染线程完成的一帧：颜色在与槽同下标的共享纹理中，fence 发出后才可读取
+struct PresentedFrame {
+    GLsync fence = nullptr;
+    int width = 0;
+    int height = 0;
+    std::vector<AABB> bounds;   // 本帧的场景包围盒，供 GUI 线程拾取
+};
+
+// 在自己的线程和上下文中推进场景并绘制，GUI 线程只负责合成最新完成的一帧
+// 上下文与 GUI 上下文在同一共享组中，着色器、纹理和几何缓冲直接共用
+class RenderThread : public QThread {
+    Q_OBJECT
+public:
+    // 需在 GUI 线程、shareContext 为当前上下文时构造
+    RenderThread(QOpenGLContext* shareContext, std::shared_ptr<Scene> scene, SharedResources* resources, QObject* parent = nullptr);
+    ~RenderThread();
+
+    void stop();
+
+    // 以下在 GUI 线程调用，functions 为当前的 GUI 上下文
+    void publishView(const ViewSnapshot& snapshot);
+    // 换到最新完成的帧并在 GPU 上等待其绘制完成，没有新帧时返回 false，仍可合成上一帧
+    bool takeFrame(GLFunctions* functions);
+    const PresentedFrame& frame() { return frames.front(); }
+    GLuint frameTexture() const { return outputTextures[frames.frontSlot()]; }
+    // 合成完当前帧后插入 fence，渲染线程覆盖该槽前等待
+    void finishRead(GLFunctions* functions);
+
+signals:
+    void frameReady();
+    void collisionDetected(const QString& message);
+
+protected:
+    void run() override;
+
+private:
+    void init();
+    void destroy();
+    void renderFrame(const ViewSnapshot& snapshot, float deltaTime);
+    void setupOutput(int slot, int width, int height);
+    void reportStats(double seconds);
+
+    QOpenGLContext* context = nullptr;
+    QOffscreenSurface* surface = nullptr;
+    GLFunctions gl;
+    std::shared_ptr<Scene> scene;
+    SharedResources* resources = nullptr;
+    SceneRenderer renderer;
+    std::atomic<bool> running{ false };
+
+    TripleBuffer<ViewSnapshot> views;
+    TripleBuffer<PresentedFrame> frames;
+    // 每个槽一套输出：共享的颜色纹理与本上下文的帧缓冲，深度模板缓冲共用
+    GLTexture outputTextures[3];
+    GLFramebuffer outputFbos[3];
+    int outputWidths[3] = {}, outputHeights[3] = {};
+    GLRenderbuffer depthStencil;
+    int depthWidth = 0, depthHeight = 0;
+    // GUI 线程合成完某槽后插入的 fence，渲染线程覆盖该槽前等待
+    std::atomic<GLsync> readFences[3] = {};
+
+    std::vector<int> collisionHits;
+    FrameStats stats;
+};
+
+
+#endif // RENDERTHREAD_H
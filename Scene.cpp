@@ -0,0 +1,461 @@
+#include "Scene.h"
+#include <QDebug>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QMatrix4x4>
+#include <algorithm>
+#include <cmath>
+
+bool Scene::load(const QByteArray& data) {
+    QJsonDocument doc(QJsonDocument::fromJson(data));
+    if (!doc.isObject()) {
+        qDebug() << "Failed to parse config file!";
+        return false;
+    }
+    QJsonObject json = doc.object();
+
+    // 读取 cube1 配置
+    QJsonObject cube1 = json["cube1"].toObject();
+    cube1Size = cube1["size"].toDouble();
+    cube1Position = QVector3D(cube1["position"].toArray()[0].toDouble(),
+                              cube1["position"].toArray()[1].toDouble(),
+                              cube1["position"].toArray()[2].toDouble());
+    cube1Rotation = QVector3D(cube1["rotation"].toArray()[0].toDouble(),
+                              cube1["rotation"].toArray()[1].toDouble(),
+                              cube1["rotation"].toArray()[2].toDouble());
+    cube1Color = QVector3D(cube1["color"].toArray()[0].toDouble(),
+                           cube1["color"].toArray()[1].toDouble(),
+                           cube1["color"].toArray()[2].toDouble());
+
+    // 读取 cube2 配置
+    QJsonObject cube2 = json["cube2"].toObject();
+    cube2Size = cube2["size"].toDouble();
+    cube2Position = QVector3D(cube2["position"].toArray()[0].toDouble(),
+                              cube2["position"].toArray()[1].toDouble(),
+                              cube2["position"].toArray()[2].toDouble());
+    cube2Rotation = QVector3D(cube2["rotation"].toArray()[0].toDouble(),
+                              cube2["rotation"].toArray()[1].toDouble(),
+                              cube2["rotation"].toArray()[2].toDouble());
+    cube2Color = QVector3D(cube2["color"].toArray()[0].toDouble(),
+                           cube2["color"].toArray()[1].toDouble(),
+                           cube2["color"].toArray()[2].toDouble());
+
+    // 读取 cube 速度，cube 为第一个动态物体
+    QJsonObject cube = json["cube"].toObject();
+    bodies.clear();
+    Body body;
+    body.velocity = QVector3D(cube["velocity"].toArray()[0].toDouble(),
+                              cube["velocity"].toArray()[1].toDouble(),
+                              cube["velocity"].toArray()[2].toDouble());
+    bodies.push_back(body);
+
+    // 读取其余动态物体
+    for (const QJsonValue& value : json["bodies"].toArray()) {
+        QJsonObject item = value.toObject();
+        Body extra;
+        extra.position = QVector3D(item["position"].toArray()[0].toDouble(),
+                                   item["position"].toArray()[1].toDouble(),
+                                   item["position"].toArray()[2].toDouble());
+        extra.velocity = QVector3D(item["velocity"].toArray()[0].toDouble(),
+                                   item["velocity"].toArray()[1].toDouble(),
+                                   item["velocity"].toArray()[2].toDouble());
+        extra.size = item["size"].toDouble(1.0);
+        QString shape = item["shape"].toString("box");
+        if (shape == "sphere") {
+            extra.shape = BodyShape::Sphere;
+        } else if (shape == "cylinder") {
+            extra.shape = BodyShape::Cylinder;
+        }
+        bodies.push_back(extra);
+    }
+    awakeCount = int(bodies.size());
+    sleeperCells.clear();
+    sleeperCellSize = 0.0f;
+    for (const Body& body : bodies) {
+        sleeperCellSize = std::max(sleeperCellSize, body.size);
+    }
+    sleeperCellSize = std::max(sleeperCellSize, 0.01f);
+
+    // 读取阻尼与休眠配置
+    QJsonObject physics = json["physics"].toObject();
+    damping = physics["damping"].toDouble(0.0);
+    sleepSpeed = physics["sleepSpeed"].toDouble(0.05);
+    sleepSteps = physics["sleepSteps"].toInt(60);
+
+    // 静态立方体按旋转后的顶点求包围盒，只在配置变化时重建
+    staticColliders = {
+        calculateRotatedAABB(cube1Position, cube1Rotation, cube1Size),
+        calculateRotatedAABB(cube2Position, cube2Rotation, cube2Size)
+    };
+
+    // 读取纹理数组盒子：逐个列出或按网格生成，网格中的纹理层依次轮换
+    QJsonObject boxConfig = json["boxes"].toObject();
+    boxLayers.clear();
+    boxes.clear();
+    for (const QJsonValue& layer : boxConfig["layers"].toArray()) {
+        boxLayers.push_back(layer.toString());
+    }
+    for (const QJsonValue& value : boxConfig["items"].toArray()) {
+        QJsonObject item = value.toObject();
+        BoxInstance box;
+        box.position = QVector3D(item["position"].toArray()[0].toDouble(),
+                                 item["position"].toArray()[1].toDouble(),
+                                 item["position"].toArray()[2].toDouble());
+        box.size = item["size"].toDouble(1.0);
+        box.layer = item["layer"].toInt();
+        boxes.push_back(box);
+    }
+    QJsonObject grid = boxConfig["grid"].toObject();
+    boxGrid = BoxGrid();
+    if (!grid.isEmpty() && !boxLayers.empty()) {
+        QJsonArray count = grid["count"].toArray();
+        boxGrid.count = { std::max(0, count[0].toInt()), std::max(0, count[1].toInt()), std::max(0, count[2].toInt()) };
+        boxGrid.origin = QVector3D(grid["origin"].toArray()[0].toDouble(),
+                                   grid["origin"].toArray()[1].toDouble(),
+                                   grid["origin"].toArray()[2].toDouble());
+        boxGrid.spacing = grid["spacing"].toDouble(1.0);
+        boxGrid.size = grid["size"].toDouble(0.5);
+        boxGrid.layers = int(boxLayers.size());
+    }
+
+    // 读取流式加载配置，开启时网格盒子由各块按需生成，这里只展开逐个列出的盒子
+    QJsonObject streamingConfig = json["streaming"].toObject();
+    streaming.enabled = streamingConfig["enabled"].toBool(false) && boxGrid.total() > 0;
+    streaming.cellSize = std::max(float(streamingConfig["cellSize"].toDouble(2.0)), boxGrid.spacing);
+    streaming.loadRadius = streamingConfig["loadRadius"].toDouble(4.0);
+    streaming.prefetchSeconds = std::max(0.0, streamingConfig["prefetchSeconds"].toDouble(0.5));
+    streaming.budgetKB = std::max(1, streamingConfig["budgetKB"].toInt(64));
+    if (!streaming.enabled) {
+        boxGrid.generate({ 0, 0, 0 }, boxGrid.count, boxes);
+    }
+
+    // 读取远处盒子的代理配置
+    QJsonObject proxyConfig = json["proxies"].toObject();
+    proxies.enabled = proxyConfig["enabled"].toBool(false);
+    proxies.clusterSize = std::max(0.1, proxyConfig["clusterSize"].toDouble(2.0));
+    proxies.levels = std::clamp(proxyConfig["levels"].toInt(2), 1, 6);
+    proxies.pixels = proxyConfig["pixels"].toDouble(48.0);
+    boxBounds = AABB();
+    for (size_t i = 0; i < boxes.size(); i++) {
+        BoxInstance& box = boxes[i];
+        if (box.layer < 0 || box.layer >= int(boxLayers.size())) {
+            qDebug() << "Box texture layer out of range:" << box.layer;
+            box.layer = 0;
+        }
+        AABB bounds = calculateAABB(box.position, box.size);
+        if (i == 0) {
+            boxBounds = bounds;
+        } else {
+            boxBounds.min = QVector3D(std::min(boxBounds.min.x(), bounds.min.x()),
+                                      std::min(boxBounds.min.y(), bounds.min.y()),
+                                      std::min(boxBounds.min.z(), bounds.min.z()));
+            boxBounds.max = QVector3D(std::max(boxBounds.max.x(), bounds.max.x()),
+                                      std::max(boxBounds.max.y(), bounds.max.y()),
+                                      std::max(boxBounds.max.z(), bounds.max.z()));
+        }
+    }
+
+    // 读取粒子配置
+    QJsonObject particleConfig = json["particles"].toObject();
+    particles.count = std::max(0, particleConfig["count"].toInt(0));
+    particles.size = particleConfig["size"].toDouble(0.1);
+    particles.speed = particleConfig["speed"].toDouble(3.0);
+    particles.gpu = particleConfig["gpu"].toBool(true);
+    particles.seed = quint32(particleConfig["seed"].toInt(1));
+
+    // 读取滤镜配置
+    QString filterName = json["filter"].toString();
+    if (filterName == "invert") {
+        filter = Filter::Invert;
+    } else if (filterName == "gray") {
+        filter = Filter::Gray;
+    } else {
+        filter = Filter::None;
+    }
+
+    // 读取渲染通道配置
+    QJsonObject render = json["render"].toObject();
+    depthPrepass = render["depthPrepass"].toBool(false);
+    overdraw = render["overdraw"].toBool(false);
+    occlusion = render["occlusion"].toBool(false);
+    framesInFlight = std::clamp(render["framesInFlight"].toInt(2), 1, 3);
+    prewarmShaders = render["prewarmShaders"].toBool(true);
+    workerThreads = std::max(0, render["workerThreads"].toInt(0));
+    logStats = render["logStats"].toBool(false);
+
+    // 设置边界 AABB
+    boundaryAABB.min = QVector3D(-5.0f, -5.0f, -5.0f);
+    boundaryAABB.max = QVector3D(5.0f, 5.0f, 5.0f);
+
+    loaded = true;
+    return true;
+}
+
+void Scene::step(float deltaTime, std::vector<int>& hits) {
+    hits.clear();
+
+    // 全部休眠时整个模拟直接跳过
+    if (awakeCount == 0) {
+        return;
+    }
+
+    awakeCount = 0;
+    for (int i = 0; i < int(bodies.size()); i++) {
+        Body& body = bodies[i];
+        if (body.asleep) {
+            continue;
+        }
+        stepBody(body, deltaTime, hits);
+
+        // 速度连续 sleepSteps 步低于阈值则休眠
+        if (body.velocity.lengthSquared() < sleepSpeed * sleepSpeed) {
+            body.stillSteps++;
+        } else {
+            body.stillSteps = 0;
+        }
+        if (sleepSteps > 0 && body.stillSteps >= sleepSteps) {
+            body.asleep = true;
+            body.velocity = QVector3D();
+            addSleeper(i);
+        } else {
+            awakeCount++;
+        }
+    }
+
+    if (awakeCount > 0 && awakeCount < int(bodies.size())) {
+        wakeTouched();
+    }
+}
+
+void Scene::wake(int index) {
+    Body& body = bodies[index];
+    if (body.asleep) {
+        removeSleeper(index);
+        body.asleep = false;
+        body.stillSteps = 0;
+        awakeCount++;
+    }
+}
+
+void Scene::wakeTouched() {
+    // 醒着的物体碰到休眠物体时将其唤醒；只查醒着物体附近的格子，耗时与醒着的物体数成正比
+    touched.clear();
+    for (const Body& body : bodies) {
+        if (body.asleep) {
+            continue;
+        }
+        AABB awake = calculateAABB(body.position, body.size);
+        // 与之相交的休眠物体，中心离它不超过两者半边长之和
+        float reach = (body.size + sleeperCellSize) * 0.5f;
+        int low[3], high[3];
+        for (int axis = 0; axis < 3; axis++) {
+            low[axis] = int(std::floor((body.position[axis] - reach) / sleeperCellSize));
+            high[axis] = int(std::floor((body.position[axis] + reach) / sleeperCellSize));
+        }
+        for (int x = low[0]; x <= high[0]; x++) {
+            for (int y = low[1]; y <= high[1]; y++) {
+                for (int z = low[2]; z <= high[2]; z++) {
+                    auto found = sleeperCells.find(cellKey(x, y, z));
+                    if (found == sleeperCells.end()) {
+                        continue;
+                    }
+                    for (int index : found->second) {
+                        if (checkCollision(awake, calculateAABB(bodies[index].position, bodies[index].size)) != NO_COLLISION) {
+                            touched.push_back(index);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    // 遍历结束后再唤醒，同一物体被多次碰到时只有第一次生效
+    for (int index : touched) {
+        wake(index);
+    }
+}
+
+void Scene::addSleeper(int body) {
+    sleeperCells[sleeperCell(bodies[body].position)].push_back(body);
+}
+
+void Scene::removeSleeper(int body) {
+    auto found = sleeperCells.find(sleeperCell(bodies[body].position));
+    if (found == sleeperCells.end()) {
+        return;
+    }
+    std::vector<int>& cell = found->second;
+    auto position = std::find(cell.begin(), cell.end(), body);
+    if (position != cell.end()) {
+        *position = cell.back();
+        cell.pop_back();
+    }
+    if (cell.empty()) {
+        sleeperCells.erase(found);
+    }
+}
+
+qint64 Scene::sleeperCell(const QVector3D& position) const {
+    return cellKey(int(std::floor(position.x() / sleeperCellSize)),
+                   int(std::floor(position.y() / sleeperCellSize)),
+                   int(std::floor(position.z() / sleeperCellSize)));
+}
+
+qint64 Scene::cellKey(int x, int y, int z) {
+    // 每轴取低 21 位，边界内的格子不会重叠
+    return (qint64(x & 0x1FFFFF) << 42) | (qint64(y & 0x1FFFFF) << 21) | qint64(z & 0x1FFFFF);
+}
+
+void Scene::stepBody(Body& body, float deltaTime, std::vector<int>& hits) {
+    // 更新立方体位置
+    if (damping > 0.0f) {
+        body.velocity *= std::max(0.0f, 1.0f - damping * deltaTime);
+    }
+    body.position += body.velocity * deltaTime;
+
+    // 计算立方体的 AABB，静态立方体直接使用缓存
+    AABB cubeAABB = calculateAABB(body.position, body.size);
+    const AABB& cube1AABB = staticColliders[0];
+    const AABB& cube2AABB = staticColliders[1];
+
+    // 检查动态立方体与静态立方体1的碰撞
+    CollisionFace collisionFace = checkCollision(cubeAABB, cube1AABB);
+    if (collisionFace != NO_COLLISION) {
+        hits.push_back(1);
+
+        if (collisionFace == COLLISION_X) {
+            body.velocity.setX(-body.velocity.x());
+        } else if (collisionFace == COLLISION_Y) {
+            body.velocity.setY(-body.velocity.y());
+        } else if (collisionFace == COLLISION_Z) {
+            body.velocity.setZ(-body.velocity.z());
+        }
+        // 调整位置以避免下一帧再次检测到碰撞
+        body.position += body.velocity * deltaTime;
+    }
+
+    // 检查动态立方体与静态立方体2的碰撞
+    collisionFace = checkCollision(cubeAABB, cube2AABB);
+    if (collisionFace != NO_COLLISION) {
+        hits.push_back(2);
+
+        if (collisionFace == COLLISION_X) {
+            body.velocity.setX(-body.velocity.x());
+        } else if (collisionFace == COLLISION_Y) {
+            body.velocity.setY(-body.velocity.y());
+        } else if (collisionFace == COLLISION_Z) {
+            body.velocity.setZ(-body.velocity.z());
+        }
+        // 调整位置以避免下一帧再次检测到碰撞
+        body.position += body.velocity * deltaTime;
+    }
+
+     // 检查与边界的碰撞
+    if (cubeAABB.min.x() < boundaryAABB.min.x() || cubeAABB.max.x() > boundaryAABB.max.x()) {
+        // QString message = "Boundary: X axis!";
+        // emit collisionDetected(message);
+        body.velocity.setX(-body.velocity.x());
+        // 调整位置以避免下一帧再次检测到碰撞
+        body.position.setX(body.position.x() + body.velocity.x() * deltaTime);
+    }
+    if (cubeAABB.min.y() < boundaryAABB.min.y() || cubeAABB.max.y() > boundaryAABB.max.y()) {
+        // QString message = "Boundary: Y axis!";
+        // emit collisionDetected(message);
+        body.velocity.setY(-body.velocity.y());
+        // 调整位置以避免下一帧再次检测到碰撞
+        body.position.setY(body.position.y() + body.velocity.y() * deltaTime);
+    }
+    if (cubeAABB.min.z() < boundaryAABB.min.z() || cubeAABB.max.z() > boundaryAABB.max.z()) {
+        // QString message = "Boundary: Z axis!";
+        // emit collisionDetected(message);
+        body.velocity.setZ(-body.velocity.z());
+        // 调整位置以避免下一帧再次检测到碰撞
+        body.position.setZ(body.position.z() + body.velocity.z() * deltaTime);
+    }
+}
+
+void Scene::bounds(std::vector<AABB>& out) const {
+    // 下标与拾取时的物体名对应
+    out.resize(bodies.size() + 2);
+    out[0] = calculateAABB(bodies[0].position, bodies[0].size);
+    out[1] = staticColliders[0];
+    out[2] = staticColliders[1];
+    for (size_t i = 1; i < bodies.size(); i++) {
+        out[i + 2] = calculateAABB(bodies[i].position, bodies[i].size);
+    }
+}
+
+void BoxGrid::generate(const std::array<int, 3>& begin, const std::array<int, 3>& end, std::vector<BoxInstance>& out) const {
+    for (int x = begin[0]; x < end[0]; x++) {
+        for (int y = begin[1]; y < end[1]; y++) {
+            for (int z = begin[2]; z < end[2]; z++) {
+                BoxInstance box;
+                box.position = origin + QVector3D(x, y, z) * spacing;
+                box.size = size;
+                box.layer = (x + y + z) % layers;
+                out.push_back(box);
+            }
+        }
+    }
+}
+
+AABB BoxGrid::bounds(const std::array<int, 3>& begin, const std::array<int, 3>& end) const {
+    QVector3D half(size * 0.5f, size * 0.5f, size * 0.5f);
+    AABB box;
+    box.min = origin + QVector3D(begin[0], begin[1], begin[2]) * spacing - half;
+    box.max = origin + QVector3D(end[0] - 1, end[1] - 1, end[2] - 1) * spacing + half;
+    return box;
+}
+
+AABB Scene::calculateAABB(const QVector3D& position, float size) {
+    AABB aabb;
+    aabb.min = position - QVector3D(size, size, size) * 0.5f;
+    aabb.max = position + QVector3D(size, size, size) * 0.5f;
+    return aabb;
+}
+
+AABB Scene::calculateRotatedAABB(const QVector3D& position, const QVector3D& rotation, float size) {
+    // 与 setupCube 烘焙顶点时的变换一致
+    QMatrix4x4 model;
+    model.translate(position);
+    model.rotate(rotation.x(), QVector3D(1.0f, 0.0f, 0.0f));
+    model.rotate(rotation.y(), QVector3D(0.0f, 1.0f, 0.0f));
+    model.rotate(rotation.z(), QVector3D(0.0f, 0.0f, 1.0f));
+
+    float half = size * 0.5f;
+    AABB aabb;
+    for (int i = 0; i < 8; i++) {
+        QVector3D corner = model.map(QVector3D((i & 1) ? half : -half, (i & 2) ? half : -half, (i & 4) ? half : -half));
+        if (i == 0) {
+            aabb.min = corner;
+            aabb.max = corner;
+        } else {
+            aabb.min = QVector3D(std::min(aabb.min.x(), corner.x()), std::min(aabb.min.y(), corner.y()), std::min(aabb.min.z(), corner.z()));
+            aabb.max = QVector3D(std::max(aabb.max.x(), corner.x()), std::max(aabb.max.y(), corner.y()), std::max(aabb.max.z(), corner.z()));
+        }
+    }
+    return aabb;
+}
+
+CollisionFace Scene::checkCollision(const AABB& a, const AABB& b) {
+    bool collisionX = (a.min.x() <= b.max.x() && a.max.x() >= b.min.x());
+    bool collisionY = (a.min.y() <= b.max.y() && a.max.y() >= b.min.y());
+    bool collisionZ = (a.min.z() <= b.max.z() && a.max.z() >= b.min.z());
+
+    if (collisionX && collisionY && collisionZ) {
+        // Determine which face the collision occurred on
+        float overlapX = std::min(a.max.x() - b.min.x(), b.max.x() - a.min.x());
+        float overlapY = std::min(a.max.y() - b.min.y(), b.max.y() - a.min.y());
+        float overlapZ = std::min(a.max.z() - b.min.z(), b.max.z() - a.min.z());
+
+        if (overlapX < overlapY && overlapX < overlapZ) {
+            return COLLISION_X;
+        } else if (overlapY < overlapX && overlapY < overlapZ) {
+            return COLLISION_Y;
+        } else {
+            return COLLISION_Z;
+        }
+    }
+
+    return NO_COLLISION;
+}
@@ -0,0 +1,162 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+
+#include <QByteArray>
+#include <QString>
+#include <QVector3D>
+#include <array>
+#include <unordered_map>
+#include <vector>
+#include "AABB.h"
+
+enum CollisionFace {
+    NO_COLLISION,
+    COLLISION_X,
+    COLLISION_Y,
+    COLLISION_Z
+};
+
+enum class Filter {
+    None,
+    Invert,
+    Gray
+};
+
+// 用纹理数组实例化绘制的盒子，layer 为纹理层下标
+struct BoxInstance {
+    QVector3D position;
+    float size = 1.0f;
+    int layer = 0;
+};
+
+// 按网格生成的盒子，纹理层按下标之和轮换；流式加载时不在加载配置时展开，由各块按需生成
+struct BoxGrid {
+    std::array<int, 3> count = { 0, 0, 0 };
+    QVector3D origin;
+    float spacing = 1.0f;
+    float size = 0.5f;
+    int layers = 1;
+
+    int total() const { return count[0] * count[1] * count[2]; }
+    // 网格下标 [begin, end) 内的盒子，按 x、y、z 嵌套的顺序追加到 out
+    void generate(const std::array<int, 3>& begin, const std::array<int, 3>& end, std::vector<BoxInstance>& out) const;
+    AABB bounds(const std::array<int, 3>& begin, const std::array<int, 3>& end) const;
+};
+
+// 分块流式加载：网格盒子每 cellSize 见方为一块，相机 loadRadius 内的块在后台生成后上传，
+// 预测 prefetchSeconds 之后的相机位置提前请求；显存槽按 budgetKB 预先分配，用满时淘汰最久未用的块
+struct StreamingConfig {
+    bool enabled = false;
+    float cellSize = 2.0f;
+    float loadRadius = 4.0f;
+    float prefetchSeconds = 0.5f;
+    int budgetKB = 64;
+};
+
+// 远处静态盒子的层次代理：盒子按 clusterSize 见方逐级聚成 levels 层簇，
+// 簇在屏幕上的投影小于 pixels 像素时绘制合并后的代理网格，否则展开为子簇或簇内的盒子
+struct ProxyConfig {
+    bool enabled = false;
+    float clusterSize = 2.0f;
+    int levels = 2;
+    float pixels = 48.0f;
+};
+
+// 在边界内反弹的粒子群，gpu 为 true 时用变换反馈在 GPU 上积分
+struct ParticleConfig {
+    int count = 0;
+    float size = 0.1f;
+    float speed = 3.0f;
+    bool gpu = true;
+    quint32 seed = 1;
+};
+
+enum class BodyShape {
+    Box,
+    Sphere,
+    Cylinder
+};
+
+// 动态物体：速度持续低于阈值若干步后休眠，不再积分、不参与碰撞检测，直到被醒着的物体碰到
+struct Body {
+    QVector3D position;
+    QVector3D velocity;
+    float size = 1.0f;
+    BodyShape shape = BodyShape::Box;   // 只影响绘制，碰撞仍按包围盒
+    int stillSteps = 0;
+    bool asleep = false;
+};
+
+// 场景状态与模拟：多视口时只有一份，由驱动视图每帧推进一次，其余视图只读
+class Scene {
+public:
+    bool load(const QByteArray& config);
+    bool isLoaded() const { return loaded; }
+
+    // 推进一帧，hits 返回本帧碰到的静态立方体编号（1、2）
+    void step(float deltaTime, std::vector<int>& hits);
+    void wake(int body);
+    int awakeBodies() const { return awakeCount; }
+
+    // 拾取用包围盒：动态立方体、cube1、cube2，之后是其余动态物体；写入 out 以复用其容量
+    void bounds(std::vector<AABB>& out) const;
+
+    static AABB calculateAABB(const QVector3D& position, float size);
+    // 按配置的旋转（依次绕 x、y、z 轴）求立方体的包围盒
+    static AABB calculateRotatedAABB(const QVector3D& position, const QVector3D& rotation, float size);
+    static CollisionFace checkCollision(const AABB& a, const AABB& b);
+
+    float cube1Size = 1.0f;
+    QVector3D cube1Position, cube1Rotation, cube1Color;
+
+    float cube2Size = 1.0f;
+    QVector3D cube2Position, cube2Rotation, cube2Color;
+
+    // bodies[0] 为配置中的动态立方体
+    std::vector<Body> bodies;
+    float damping = 0.0f;       // 每秒速度衰减比例
+    float sleepSpeed = 0.05f;
+    int sleepSteps = 60;
+    AABB boundaryAABB;
+
+    // 纹理数组的各层图片与静态盒子
+    std::vector<QString> boxLayers;
+    std::vector<BoxInstance> boxes;
+    AABB boxBounds;             // 只含已展开的盒子
+    BoxGrid boxGrid;
+    StreamingConfig streaming;
+    ProxyConfig proxies;        // 只作用于已展开的盒子，流式加载的块不参与
+
+    ParticleConfig particles;
+
+    // 各视图的初始渲染设置
+    Filter filter = Filter::None;
+    bool depthPrepass = false;
+    bool overdraw = false;
+    bool occlusion = false;
+    int framesInFlight = 2;     // CPU 最多领先 GPU 的帧数，1 为逐帧串行
+    bool prewarmShaders = true; // 帧间逐个编译尚未用到的着色器变体
+    int workerThreads = 0;      // 准备绘制列表的线程数（含渲染线程），0 为按核数
+    bool logStats = false;      // 每秒在调试输出中打印帧统计与 GL 对象报告
+
+private:
+    void stepBody(Body& body, float deltaTime, std::vector<int>& hits);
+    void wakeTouched();
+    // 休眠物体按中心所在的格子登记，格子边长取最大物体的边长
+    void addSleeper(int body);
+    void removeSleeper(int body);
+    qint64 sleeperCell(const QVector3D& position) const;
+    static qint64 cellKey(int x, int y, int z);
+
+    // 静态碰撞体的包围盒只在加载配置时计算一次
+    std::vector<AABB> staticColliders;
+    int awakeCount = 0;
+    float sleeperCellSize = 1.0f;
+    std::unordered_map<qint64, std::vector<int>> sleeperCells;
+    std::vector<int> touched;
+    bool loaded = false;
+};
+
+
+#endif // SCENE_H
@@ -0,0 +1,614 @@
+#include "SceneRenderer.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <algorithm>
+
+namespace {
+
+// 均匀缩放后平移，直接写出各元素，省去 translate/scale 的矩阵乘
+QMatrix4x4 modelMatrix(const QVector3D& position, float size) {
+    return QMatrix4x4(size, 0.0f, 0.0f, position.x(),
+                      0.0f, size, 0.0f, position.y(),
+                      0.0f, 0.0f, size, position.z(),
+                      0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+}
+
+void SceneRenderer::init(SharedResources* shared, int framesInFlight, int width, int height) {
+    initializeOpenGLFunctions();
+    resources = shared;
+    pipeline.init(this, framesInFlight);
+
+    vertexArrays.init(this, resources->geometry);
+    boxArray = vertexArrays.addInstanced(resources->geometry, VertexFormat::Pos3Tex2, resources->boxInstanceBuffer,
+                                         VertexArrays::FLOATS_PER_INSTANCE, 4);
+    if (resources->particles.count() > 0) {
+        for (int i = 0; i < 2; i++) {
+            particleSources[i] = vertexArrays.addStateArray(resources->particles.buffer(i), 2);
+            particleDraws[i] = vertexArrays.addInstanced(resources->geometry, VertexFormat::Pos3Tex2, resources->particles.buffer(i),
+                                                         ParticleSystem::FLOATS_PER_PARTICLE, 7);
+        }
+    }
+    const std::vector<ProxyNode>& proxyNodes = resources->proxies.nodes;
+    proxyArrays.assign(proxyNodes.size(), 0);
+    for (int node = 0; node < int(proxyNodes.size()); node++) {
+        if (proxyNodes[node].isLeaf()) {
+            proxyArrays[node] = vertexArrays.addInstanced(resources->geometry, VertexFormat::Pos3Tex2, resources->boxInstanceBuffer,
+                                                          VertexArrays::FLOATS_PER_INSTANCE, 4, proxyNodes[node].firstInstance);
+        }
+    }
+    const ChunkStreamer& streaming = resources->streaming;
+    for (int slot = 0; slot < streaming.slotCount(); slot++) {
+        streamArrays.push_back(vertexArrays.addInstanced(resources->geometry, VertexFormat::Pos3Tex2, streaming.buffer(),
+                                                         VertexArrays::FLOATS_PER_INSTANCE, 4, slot * streaming.slotCapacity()));
+    }
+
+    fboWidth = width;
+    fboHeight = height;
+    setupFrameBuffer();
+}
+
+void SceneRenderer::destroy() {
+    if (!resources) {
+        return;
+    }
+    pipeline.destroy();
+    vertexArrays.destroy();
+    streamArrays.clear();
+    proxyArrays.clear();
+    eyeTimer.invalidate();
+    for (std::vector<GLQuery>& queries : occlusionQueries) {
+        queries.clear();
+    }
+    destroyFrameBuffer();
+    resources = nullptr;
+}
+
+void SceneRenderer::resize(int width, int height) {
+    if (width == fboWidth && height == fboHeight) {
+        return;
+    }
+    destroyFrameBuffer();
+    fboWidth = width;
+    fboHeight = height;
+    setupFrameBuffer();
+}
+
+void SceneRenderer::destroyFrameBuffer() {
+    fbo.reset();
+    textureColorBuffer.reset();
+    rbo.reset();
+}
+
+void SceneRenderer::updateParticles(float deltaTime, const AABB& bounds, FrameStats& frameStats) {
+    if (resources->particles.count() == 0) {
+        return;
+    }
+    QElapsedTimer particleTimer;
+    particleTimer.start();
+    resources->particles.update(this, particleSources[resources->particles.current()], deltaTime, bounds);
+    vertexArrays.unbind();
+    frameStats.particleMsSum += particleTimer.nsecsElapsed() / 1000000.0;
+    frameStats.particleSamples++;
+}
+
+void SceneRenderer::render(const Scene& currentScene, const QMatrix4x4& view, const QMatrix4x4& projection,
+                           const RenderSettings& renderSettings, GLuint target, FrameStats& frameStats) {
+    scene = &currentScene;
+    settings = renderSettings;
+    stats = &frameStats;
+    if (!settings.occlusion) {
+        occlusionPending[0].clear();
+        occlusionPending[1].clear();
+    }
+
+    // 槽空闲后写入本帧的相机参数，之后各通道的着色器共用
+    pipeline.beginFrame(view, projection, frameStats);
+
+    // 绑定帧缓冲对象，统计重绘时需要其中的模板附件
+    bool useFbo = settings.needsFramebuffer();
+    glBindFramebuffer(GL_FRAMEBUFFER, useFbo ? fbo : target);
+    glViewport(0, 0, fboWidth, fboHeight);
+    glEnable(GL_DEPTH_TEST);
+
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+    // 不透明物体由近到远，深度预通道可选，天空盒最后绘制
+    if (resources->streaming.enabled()) {
+        updateStreaming(view);
+    }
+    buildDrawList(view, projection);
+    if (settings.depthPrepass) {
+        drawDepthPrepass();
+    }
+    if (settings.occlusion) {
+        drawOcclusionQueries(view);
+    }
+    if (settings.overdraw) {
+        beginOverdrawCount();
+    }
+    drawOpaque();
+    drawSkybox();
+    if (settings.overdraw) {
+        endOverdrawCount();
+    }
+
+    if (settings.filter != Filter::None) {
+        // 解绑帧缓冲对象
+        glBindFramebuffer(GL_FRAMEBUFFER, target);
+        // 清除默认帧缓冲
+        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        // 选择后期处理着色器
+        QOpenGLShaderProgram& program = shader(SharedResources::filterShader(settings.filter));
+        program.bind();
+        {
+            glDisable(GL_DEPTH_TEST);
+            glBindTexture(GL_TEXTURE_2D, textureColorBuffer);	// use the color attachment texture as the texture of the quad plane
+            stats->textureBinds++;
+            vertexArrays.draw(resources->quadMesh);
+            stats->drawCalls++;
+        }
+        program.release();
+    } else if (useFbo) {
+        // 无滤镜时直接把帧缓冲颜色拷贝到目标
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target);
+        glBlitFramebuffer(0, 0, fboWidth, fboHeight, 0, 0, fboWidth, fboHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, target);
+    }
+
+    vertexArrays.unbind();
+    pipeline.endFrame();
+
+    // 本帧已提交，顺带编译一个待预热的变体
+    resources->shaders.warmUp(this, frameStats);
+    stats = nullptr;
+    scene = nullptr;
+}
+
+void SceneRenderer::buildDrawList(const QMatrix4x4& view, const QMatrix4x4& projection) {
+    QElapsedTimer buildTimer;
+    buildTimer.start();
+    Frustum frustum = Frustum::fromMatrix(projection * view);
+
+    // 动态物体按块分给工作线程：视锥测试、直接写出模型矩阵和观察深度，结果写入各块自己的列表
+    int bodyCount = int(scene->bodies.size());
+    int chunks = JobSystem::chunkCount(bodyCount, BODIES_PER_CHUNK);
+    if (int(chunkItems.size()) < chunks) {
+        chunkItems.resize(chunks);
+        chunkOffsets.resize(chunks);
+    }
+    resources->jobs.parallelFor(bodyCount, BODIES_PER_CHUNK, [&](int chunk, int begin, int end) {
+        std::vector<DrawItem>& items = chunkItems[chunk];
+        items.clear();
+        for (int i = begin; i < end; i++) {
+            const Body& body = scene->bodies[i];
+            AABB bounds = Scene::calculateAABB(body.position, body.size);
+            if (!frustum.intersects(bounds)) {
+                continue;
+            }
+            // bodies[0] 为原来的动态立方体，其余动态物体按形状选择网格
+            DrawItem item;
+            item.program = DrawProgram::Textured;
+            item.mesh = body.shape == BodyShape::Sphere ? resources->sphereMesh
+                      : body.shape == BodyShape::Cylinder ? resources->cylinderMesh
+                      : resources->cubeMesh;
+            item.model = modelMatrix(body.position, body.size);
+            item.center = body.position;
+            item.viewDepth = -view.map(body.position).z();
+            item.bounds = bounds;
+            item.occlusionSlot = i == 0 ? 0 : 2 + i;
+            items.push_back(item);
+        }
+    });
+
+    // 前缀和给出各块在提交列表中的位置，各块拷入互不重叠的区间，合并不需要加锁
+    size_t visibleBodies = 0;
+    for (int chunk = 0; chunk < chunks; chunk++) {
+        chunkOffsets[chunk] = visibleBodies;
+        visibleBodies += chunkItems[chunk].size();
+    }
+    opaqueItems.clear();
+    opaqueItems.resize(visibleBodies);
+    resources->jobs.parallelFor(chunks, 1, [&](int chunk, int, int) {
+        std::copy(chunkItems[chunk].begin(), chunkItems[chunk].end(), opaqueItems.begin() + chunkOffsets[chunk]);
+    });
+    stats->frustumCulled += bodyCount - int(visibleBodies);
+
+    // 静态立方体的变换已烘焙进顶点，模型矩阵为单位阵；它们同时是遮挡体，不做视锥剔除
+    DrawItem cube1;
+    cube1.program = DrawProgram::Colored;
+    cube1.mesh = resources->cube1Mesh;
+    cube1.center = scene->cube1Position;
+    cube1.occluder = true;
+    opaqueItems.push_back(cube1);
+
+    DrawItem cube2;
+    cube2.program = DrawProgram::Colored;
+    cube2.mesh = resources->cube2Mesh;
+    cube2.center = scene->cube2Position;
+    cube2.occluder = true;
+    opaqueItems.push_back(cube2);
+
+    // 纹理数组盒子整体作为一项，按包围盒中心排序；有代理层次时按簇逐级选择
+    if (!resources->proxies.isEmpty()) {
+        QVector3D eye = view.inverted().column(3).toVector3D();
+        float pixelScale = projection(1, 1) * fboHeight * 0.5f;
+        for (int root = 0; root < resources->proxies.rootCount; root++) {
+            addProxyNode(root, frustum, eye, pixelScale);
+        }
+    } else if (resources->boxCount > 0) {
+        if (frustum.intersects(scene->boxBounds)) {
+            DrawItem boxes;
+            boxes.program = DrawProgram::TextureArray;
+            boxes.mesh = resources->cubeMesh;
+            boxes.center = (scene->boxBounds.min + scene->boxBounds.max) * 0.5f;
+            boxes.instanceCount = resources->boxCount;
+            boxes.instanceArray = boxArray;
+            boxes.bounds = scene->boxBounds;
+            boxes.occlusionSlot = 1;
+            opaqueItems.push_back(boxes);
+        } else {
+            stats->frustumCulled++;
+        }
+    }
+
+    // 流式加载的块各为一项实例化绘制，按块的包围盒剔除
+    const std::vector<StreamChunk>& streamChunks = resources->streaming.chunks();
+    for (int index : resources->streaming.resident()) {
+        const StreamChunk& chunk = streamChunks[index];
+        if (!frustum.intersects(chunk.bounds)) {
+            stats->frustumCulled++;
+            continue;
+        }
+        DrawItem item;
+        item.program = DrawProgram::TextureArray;
+        item.mesh = resources->cubeMesh;
+        item.center = (chunk.bounds.min + chunk.bounds.max) * 0.5f;
+        item.instanceCount = chunk.boxCount;
+        item.instanceArray = streamArrays[chunk.slot];
+        item.bounds = chunk.bounds;
+        opaqueItems.push_back(item);
+    }
+
+    // 粒子直接从当前状态缓冲实例化绘制，整体按边界剔除
+    if (resources->particles.count() > 0 && !frustum.intersects(scene->boundaryAABB)) {
+        stats->frustumCulled++;
+    } else if (resources->particles.count() > 0) {
+        DrawItem particles;
+        particles.program = DrawProgram::TextureArray;
+        particles.mesh = resources->cubeMesh;
+        particles.center = (scene->boundaryAABB.min + scene->boundaryAABB.max) * 0.5f;
+        particles.instanceCount = resources->particles.count();
+        particles.instanceArray = particleDraws[resources->particles.current()];
+        particles.bounds = scene->boundaryAABB;
+        particles.occlusionSlot = 2;
+        opaqueItems.push_back(particles);
+    }
+
+    // 观察空间中相机朝向 -z，深度越小越近
+    for (size_t i = visibleBodies; i < opaqueItems.size(); i++) {
+        opaqueItems[i].viewDepth = -view.map(opaqueItems[i].center).z();
+    }
+    std::sort(opaqueItems.begin(), opaqueItems.end(), [](const DrawItem& a, const DrawItem& b) {
+        return a.viewDepth < b.viewDepth;
+    });
+    stats->drawListMsSum += buildTimer.nsecsElapsed() / 1000000.0;
+    stats->drawListSamples++;
+}
+
+void SceneRenderer::addProxyNode(int node, const Frustum& frustum, const QVector3D& eye, float pixelScale) {
+    const ProxyNode& cluster = resources->proxies.nodes[node];
+    if (!frustum.intersects(cluster.bounds)) {
+        stats->frustumCulled++;
+        return;
+    }
+
+    // 投影大小按包围球估计，相机在球内时视为无穷大
+    QVector3D center = (cluster.bounds.min + cluster.bounds.max) * 0.5f;
+    float diameter = (cluster.bounds.max - cluster.bounds.min).length();
+    float distance = (center - eye).length();
+    bool small = distance > diameter * 0.5f && diameter * pixelScale / distance < scene->proxies.pixels;
+
+    DrawItem item;
+    item.center = center;
+    if (small) {
+        // 代理顶点已是世界坐标，与静态立方体同属纯色项，相邻时合并为一次多重绘制
+        item.program = DrawProgram::Colored;
+        item.mesh = cluster.proxy;
+        opaqueItems.push_back(item);
+        stats->proxyDraws++;
+    } else if (cluster.isLeaf()) {
+        item.program = DrawProgram::TextureArray;
+        item.mesh = resources->cubeMesh;
+        item.instanceCount = cluster.instanceCount;
+        item.instanceArray = proxyArrays[node];
+        item.bounds = cluster.bounds;
+        opaqueItems.push_back(item);
+        stats->clusterDraws++;
+    } else {
+        for (int child = cluster.firstChild; child < cluster.firstChild + cluster.childCount; child++) {
+            addProxyNode(child, frustum, eye, pixelScale);
+        }
+    }
+}
+
+void SceneRenderer::updateStreaming(const QMatrix4x4& view) {
+    // 速度取相邻两帧相机位置之差并做指数平滑；渲染服务的请求之间没有连续性，不做预取
+    QVector3D eye = view.inverted().column(3).toVector3D();
+    float seconds = eyeTimer.isValid() ? eyeTimer.nsecsElapsed() / 1e9f : 0.0f;
+    eyeTimer.start();
+    if (settings.streamBlocking || seconds <= 0.0f || seconds > 0.5f) {
+        eyeVelocity = QVector3D();
+    } else {
+        eyeVelocity = eyeVelocity * 0.5f + (eye - lastEye) / seconds * 0.5f;
+    }
+    lastEye = eye;
+    resources->streaming.update(this, eye, eyeVelocity, settings.streamBlocking, *stats);
+}
+
+void SceneRenderer::drawDepthPrepass() {
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    ShaderProgram& depthProgram = shader(SharedResources::sceneShader(0));
+    depthProgram.bind();
+    for (const DrawItem& item : opaqueItems) {
+        if (item.instanceCount > 0) {
+            continue;
+        }
+        glUniformMatrix4fv(depthProgram.modelLocation, 1, GL_FALSE, item.model.data());
+        vertexArrays.draw(item.mesh);
+        stats->drawCalls++;
+    }
+    depthProgram.release();
+
+    // 实例化的盒子用自己的着色器写深度，颜色已被屏蔽
+    QOpenGLShaderProgram& boxProgram = shader(SharedResources::sceneShader(ShaderLibrary::TEXTURE_ARRAY | ShaderLibrary::INSTANCED));
+    for (const DrawItem& item : opaqueItems) {
+        if (item.instanceCount == 0) {
+            continue;
+        }
+        boxProgram.bind();
+        vertexArrays.drawInstanced(item.instanceArray, item.mesh, item.instanceCount);
+        stats->drawCalls++;
+        boxProgram.release();
+    }
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    // 颜色通道只着色深度相等的片元，不再写深度
+    glDepthFunc(GL_LEQUAL);
+    glDepthMask(GL_FALSE);
+}
+
+void SceneRenderer::drawOcclusionQueries(const QMatrix4x4& view) {
+    collectOcclusionResults();
+    std::vector<GLQuery>& queries = occlusionQueries[occlusionFrame % 2];
+    std::vector<GLuint>& pending = occlusionPending[occlusionFrame % 2];
+    occlusionFrame++;
+
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    ShaderProgram& depthProgram = shader(SharedResources::sceneShader(0));
+    depthProgram.bind();
+
+    // 深度预通道已写入全部物体时不必再单独绘制遮挡体
+    if (!settings.depthPrepass) {
+        for (const DrawItem& item : opaqueItems) {
+            if (!item.occluder) {
+                continue;
+            }
+            glUniformMatrix4fv(depthProgram.modelLocation, 1, GL_FALSE, item.model.data());
+            vertexArrays.draw(item.mesh);
+            stats->drawCalls++;
+        }
+    }
+
+    // 包围盒只测试不写深度，与已写入的表面重合时也算可见
+    glDepthMask(GL_FALSE);
+    glDepthFunc(GL_LEQUAL);
+    QVector3D eye = view.inverted().column(3).toVector3D();
+    const float margin = 0.1f;
+    for (DrawItem& item : opaqueItems) {
+        item.occlusionQuery = 0;
+        if (item.occlusionSlot < 0) {
+            continue;
+        }
+        // 相机在包围盒内时包围盒会被近平面裁掉，不能据此判断遮挡
+        if (eye.x() > item.bounds.min.x() - margin && eye.x() < item.bounds.max.x() + margin &&
+            eye.y() > item.bounds.min.y() - margin && eye.y() < item.bounds.max.y() + margin &&
+            eye.z() > item.bounds.min.z() - margin && eye.z() < item.bounds.max.z() + margin) {
+            continue;
+        }
+        while (int(queries.size()) <= item.occlusionSlot) {
+            queries.emplace_back();
+            queries.back().create(this);
+        }
+
+        // 略微放大包围盒，避免与物体表面的深度误差造成误剔除
+        QMatrix4x4 model;
+        model.translate((item.bounds.min + item.bounds.max) * 0.5f);
+        model.scale((item.bounds.max - item.bounds.min) * 1.01f);
+        glUniformMatrix4fv(depthProgram.modelLocation, 1, GL_FALSE, model.data());
+
+        GLuint query = queries[item.occlusionSlot];
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, query);
+        vertexArrays.draw(resources->cubeMesh);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+        stats->drawCalls++;
+        item.occlusionQuery = query;
+        pending.push_back(query);
+    }
+    depthProgram.release();
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    // 遮挡体在颜色通道中以相同深度重绘，保持 LEQUAL
+    if (!settings.depthPrepass) {
+        glDepthMask(GL_TRUE);
+    }
+}
+
+void SceneRenderer::collectOcclusionResults() {
+    // 同一组查询在两帧前发起，结果通常已就绪；未就绪的不计入统计
+    std::vector<GLuint>& pending = occlusionPending[occlusionFrame % 2];
+    for (GLuint query : pending) {
+        GLuint available = 0;
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            continue;
+        }
+        GLuint visible = 0;
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT, &visible);
+        stats->occlusionTested++;
+        if (!visible) {
+            stats->occlusionCulled++;
+        }
+    }
+    pending.clear();
+}
+
+void SceneRenderer::drawOpaque() {
+    // 相邻且着色器相同的物体合并为一批，保持整体由近到远的顺序
+    size_t i = 0;
+    while (i < opaqueItems.size()) {
+        DrawProgram program = opaqueItems[i].program;
+        size_t end = i;
+        while (end < opaqueItems.size() && opaqueItems[end].program == program) {
+            end++;
+        }
+
+        if (program == DrawProgram::Textured) {
+            ShaderProgram& program = shader(SharedResources::sceneShader(ShaderLibrary::TEXTURED));
+            program.bind();
+            // bind textures on corresponding texture units
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, resources->texture1);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, resources->texture2);
+            stats->textureBinds += 2;
+            for (size_t j = i; j < end; j++) {
+                if (opaqueItems[j].occlusionQuery) {
+                    glBeginConditionalRender(opaqueItems[j].occlusionQuery, GL_QUERY_WAIT);
+                }
+                glUniformMatrix4fv(program.modelLocation, 1, GL_FALSE, opaqueItems[j].model.data());
+                vertexArrays.draw(opaqueItems[j].mesh);
+                stats->drawCalls++;
+                if (opaqueItems[j].occlusionQuery) {
+                    glEndConditionalRender();
+                }
+            }
+            program.release();
+        } else if (program == DrawProgram::TextureArray) {
+            // 所有盒子共用一个纹理数组，一次绑定、一次实例化绘制
+            QOpenGLShaderProgram& program = shader(SharedResources::sceneShader(ShaderLibrary::TEXTURE_ARRAY | ShaderLibrary::INSTANCED));
+            program.bind();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, resources->textureArray);
+            stats->textureBinds++;
+            for (size_t j = i; j < end; j++) {
+                if (opaqueItems[j].occlusionQuery) {
+                    glBeginConditionalRender(opaqueItems[j].occlusionQuery, GL_QUERY_WAIT);
+                }
+                vertexArrays.drawInstanced(opaqueItems[j].instanceArray, opaqueItems[j].mesh, opaqueItems[j].instanceCount);
+                stats->drawCalls++;
+                if (opaqueItems[j].occlusionQuery) {
+                    glEndConditionalRender();
+                }
+            }
+            program.release();
+        } else {
+            ShaderProgram& program = shader(SharedResources::sceneShader(ShaderLibrary::COLORED));
+            program.bind();
+            QMatrix4x4 model; // identity
+            glUniformMatrix4fv(program.modelLocation, 1, GL_FALSE, model.data());
+            batchMeshes.clear();
+            for (size_t j = i; j < end; j++) {
+                batchMeshes.push_back(opaqueItems[j].mesh);
+            }
+            vertexArrays.multiDraw(batchMeshes);
+            stats->drawCalls++;
+            program.release();
+        }
+        i = end;
+    }
+}
+
+void SceneRenderer::drawSkybox() {
+    // 天空盒最后绘制，被物体遮挡的像素在深度测试中直接丢弃
+    glDepthFunc(GL_LEQUAL);  // 更改深度函数，以便天空盒能在最远处绘制
+    QOpenGLShaderProgram& program = shader(SharedResources::skyboxShader());
+    program.bind();
+    {
+        // 绘制天空盒
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, resources->skyboxTexture);
+        stats->textureBinds++;
+        vertexArrays.draw(resources->skyboxMesh);
+        stats->drawCalls++;
+    }
+    program.release();
+    glDepthFunc(GL_LESS); // 重置深度函数
+    glDepthMask(GL_TRUE);
+}
+
+void SceneRenderer::beginOverdrawCount() {
+    // 每个通过深度测试的片元使模板值加一
+    glEnable(GL_STENCIL_TEST);
+    glStencilMask(0xFF);
+    glStencilFunc(GL_ALWAYS, 0, 0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
+}
+
+void SceneRenderer::endOverdrawCount() {
+    glDisable(GL_STENCIL_TEST);
+
+    // 调试模式下同步回读模板缓冲
+    stencilReadback.resize(size_t(fboWidth) * fboHeight);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, fboWidth, fboHeight, GL_STENCIL_INDEX, GL_UNSIGNED_BYTE, stencilReadback.data());
+
+    quint64 fragments = 0;
+    for (GLubyte count : stencilReadback) {
+        fragments += count;
+    }
+    if (!stencilReadback.empty()) {
+        stats->overdrawSum += double(fragments) / stencilReadback.size();
+        stats->overdrawSamples++;
+    }
+}
+
+void SceneRenderer::setupFrameBuffer() {
+    fbo.create(this);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+    // 创建颜色附件纹理
+    textureColorBuffer.create(this);
+    glBindTexture(GL_TEXTURE_2D, textureColorBuffer);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, fboWidth, fboHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    textureColorBuffer.setBytes(GLResourceRegistry::imageBytes(fboWidth, fboHeight));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureColorBuffer, 0);
+
+    // 创建渲染缓冲对象用于深度和模板测试
+    rbo.create(this);
+    glBindRenderbuffer(GL_RENDERBUFFER, rbo);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, fboWidth, fboHeight);
+    rbo.setBytes(GLResourceRegistry::imageBytes(fboWidth, fboHeight));
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        qDebug() << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!";
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+}
+
+ShaderProgram& SceneRenderer::shader(const ShaderVariant& variant) {
+    return resources->shaders.program(this, variant, *stats);
+}
@@ -0,0 +1,136 @@
+#ifndef SCENERENDERER_H
+#define SCENERENDERER_H
+
+
+#include <QElapsedTimer>
+#include <QMatrix4x4>
+#include <QOpenGLShaderProgram>
+#include <vector>
+#include "AABB.h"
+#include "FramePipeline.h"
+#include "FrameStats.h"
+#include "Frustum.h"
+#include "GeometryPool.h"
+#include "GLFunctions.h"
+#include "Scene.h"
+#include "SharedResources.h"
+
+enum class DrawProgram {
+    Textured,
+    Colored,
+    TextureArray
+};
+
+// 不透明物体的绘制项，按观察空间深度排序
+struct DrawItem {
+    DrawProgram program = DrawProgram::Colored;
+    MeshRange mesh;
+    QMatrix4x4 model;
+    QVector3D center;
+    float viewDepth = 0.0f;
+    int instanceCount = 0;  // 大于 0 时为一次实例化绘制
+    GLuint instanceArray = 0;
+    bool occluder = false;      // 大的静态物体，先写深度供其他物体做遮挡查询
+    AABB bounds;                // 遮挡查询时绘制的包围盒
+    int occlusionSlot = -1;     // 在查询对象数组中的固定下标，-1 表示不做查询
+    GLuint occlusionQuery = 0;  // 本帧已发起的查询，非 0 时按条件渲染
+};
+
+// 可在运行时切换的绘制选项
+struct RenderSettings {
+    Filter filter = Filter::None;
+    bool depthPrepass = false;
+    bool overdraw = false;
+    bool occlusion = false;
+    bool streamBlocking = false;    // 渲染服务：缺少的块当场生成上传，画面中不会缺块
+
+    // 滤镜与重绘统计需要先画进自带模板附件的帧缓冲
+    bool needsFramebuffer() const { return filter != Filter::None || overdraw; }
+};
+
+// 一个 GL 上下文中的场景绘制：本上下文的 VAO、帧缓冲、遮挡查询与绘制列表
+// 着色器、纹理和几何缓冲来自 SharedResources，可在同一共享组的任意上下文中使用
+class SceneRenderer : protected GLFunctions {
+public:
+    // 以下调用都需要本渲染器的上下文为当前上下文
+    // framesInFlight 为 CPU 最多领先 GPU 的帧数
+    void init(SharedResources* shared, int framesInFlight, int width, int height);
+    void destroy();
+    void resize(int width, int height);
+
+#ifdef GL_TRACE
+    using GLFunctions::callCounts;
+    using GLFunctions::startValidation;
+    using GLFunctions::shareValidation;
+#endif
+
+    // 推进粒子，积分时读取的状态 VAO 属于本上下文
+    void updateParticles(float deltaTime, const AABB& bounds, FrameStats& frameStats);
+    // 绘制一帧：需要时先画进自己的帧缓冲，再经滤镜或拷贝写入 target
+    void render(const Scene& currentScene, const QMatrix4x4& view, const QMatrix4x4& projection,
+                const RenderSettings& renderSettings, GLuint target, FrameStats& frameStats);
+
+    // 滤镜前的场景所在的帧缓冲
+    GLuint sceneFramebuffer() const { return fbo; }
+    int width() const { return fboWidth; }
+    int height() const { return fboHeight; }
+    int framesInFlight() const { return pipeline.depth(); }
+
+private:
+    static constexpr int BODIES_PER_CHUNK = 64;
+
+    void setupFrameBuffer();
+    void destroyFrameBuffer();
+
+    // 动态物体的视锥剔除与绘制项生成分块并行，其余几项和排序在调用线程中完成
+    void buildDrawList(const QMatrix4x4& view, const QMatrix4x4& projection);
+    // 按簇在屏幕上的投影大小选择代理网格、子簇或簇内的盒子，pixelScale 为单位距离上单位长度的像素数
+    void addProxyNode(int node, const Frustum& frustum, const QVector3D& eye, float pixelScale);
+    // 按本视图的相机位置与平滑后的移动速度更新流式加载的块
+    void updateStreaming(const QMatrix4x4& view);
+    void drawDepthPrepass();
+    void drawOcclusionQueries(const QMatrix4x4& view);
+    void collectOcclusionResults();
+    void drawOpaque();
+    void drawSkybox();
+    void beginOverdrawCount();
+    void endOverdrawCount();
+    // 取得共享库中的着色器变体，第一次用到时在本上下文中编译
+    ShaderProgram& shader(const ShaderVariant& variant);
+
+    SharedResources* resources = nullptr;
+    FramePipeline pipeline;
+    VertexArrays vertexArrays;
+    GLuint boxArray = 0;
+    GLuint particleSources[2] = {};    // 积分时读取的状态 VAO
+    GLuint particleDraws[2] = {};      // 绘制时的实例化 VAO
+    std::vector<GLuint> streamArrays;  // 流式加载的每个显存槽一个实例化 VAO
+    std::vector<GLuint> proxyArrays;   // 代理层次中每个叶簇一个实例化 VAO，按节点下标存放
+    QVector3D lastEye;
+    QVector3D eyeVelocity;
+    QElapsedTimer eyeTimer;
+    GLFramebuffer fbo;
+    GLRenderbuffer rbo;
+    GLTexture textureColorBuffer;
+    int fboWidth = 0, fboHeight = 0;
+
+    // 只在 render() 期间有效
+    const Scene* scene = nullptr;
+    FrameStats* stats = nullptr;
+    RenderSettings settings;
+
+    std::vector<DrawItem> opaqueItems;
+    // 并行生成时每块的输出与它在 opaqueItems 中的起点，跨帧复用容量
+    std::vector<std::vector<DrawItem>> chunkItems;
+    std::vector<size_t> chunkOffsets;
+    std::vector<MeshRange> batchMeshes;
+    std::vector<GLubyte> stencilReadback;
+
+    // 遮挡查询按帧交替使用两组，统计时读取上上帧已完成的结果，不等待 GPU
+    std::vector<GLQuery> occlusionQueries[2];
+    std::vector<GLuint> occlusionPending[2];
+    int occlusionFrame = 0;
+};
+
+
+#endif // SCENERENDERER_H
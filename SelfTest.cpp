@@ -0,0 +1,356 @@
+#include "SelfTest.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QRandomGenerator>
+#include <QString>
+#include <QSurfaceFormat>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "Bvh.h"
+#include "GeometryPool.h"
+#include "ParticleSystem.h"
+
+namespace {
+
+// 双精度的逐轴 slab 求交，方向分量为 0 时按起点是否在 slab 内判断，作为 BVH 的参照
+bool referenceHit(const AABB& box, const QVector3D& origin, const QVector3D& direction, const QVector3D& extent, double maxT, double& t) {
+    double tNear = 0.0;
+    double tFar = maxT;
+    for (int a = 0; a < 3; a++) {
+        double low = double(box.min[a]) - extent[a];
+        double high = double(box.max[a]) + extent[a];
+        double o = origin[a];
+        double d = direction[a];
+        if (d == 0.0) {
+            if (o < low || o > high) {
+                return false;
+            }
+            continue;
+        }
+        double t1 = (low - o) / d;
+        double t2 = (high - o) / d;
+        tNear = std::max(tNear, std::min(t1, t2));
+        tFar = std::min(tFar, std::max(t1, t2));
+    }
+    t = tNear;
+    return tNear <= tFar;
+}
+
+bool referenceNearest(const std::vector<AABB>& boxes, const QVector3D& origin, const QVector3D& direction, const QVector3D& extent,
+                      double maxT, double& nearest) {
+    bool found = false;
+    for (const AABB& box : boxes) {
+        double t;
+        if (referenceHit(box, origin, direction, extent, maxT, t) && (!found || t < nearest)) {
+            nearest = t;
+            found = true;
+        }
+    }
+    return found;
+}
+
+int referenceCount(const std::vector<AABB>& boxes, const QVector3D& origin, const QVector3D& direction, double maxT) {
+    int count = 0;
+    for (const AABB& box : boxes) {
+        double t;
+        if (referenceHit(box, origin, direction, QVector3D(), maxT, t)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// 命中的物体可能因距离相同而不同，只比较是否命中与距离
+bool sameNearest(bool hit, const RayHit& result, bool expected, double t) {
+    if (hit != expected) {
+        return false;
+    }
+    return !hit || std::abs(result.t - t) <= 1e-4 * (1.0 + t);
+}
+
+float randomFloat(QRandomGenerator& random, float low, float high) {
+    return low + float(random.generateDouble()) * (high - low);
+}
+
+QVector3D randomPoint(QRandomGenerator& random, float range) {
+    return QVector3D(randomFloat(random, -range, range), randomFloat(random, -range, range), randomFloat(random, -range, range));
+}
+
+QVector3D randomDirection(QRandomGenerator& random) {
+    while (true) {
+        QVector3D direction = randomPoint(random, 1.0f);
+        float length = direction.length();
+        if (length > 0.1f && length <= 1.0f) {
+            return direction / length;
+        }
+    }
+}
+
+}
+
+int SelfTest::bvh() {
+    const int BOX_COUNT = 100000;
+    const int RAY_COUNT = 2000;
+    const int AXIS_RAY_COUNT = 1000;
+    const int SWEEP_COUNT = 1000;
+    const int ALL_HITS_COUNT = 200;
+    const int REFIT_RAY_COUNT = 500;
+    const float RANGE = 50.0f;
+    const float MAX_DISTANCE = 200.0f;
+
+    QRandomGenerator random(1);
+    std::vector<AABB> boxes(BOX_COUNT);
+    for (AABB& box : boxes) {
+        QVector3D center = randomPoint(random, RANGE);
+        QVector3D half(randomFloat(random, 0.025f, 0.5f), randomFloat(random, 0.025f, 0.5f), randomFloat(random, 0.025f, 0.5f));
+        box.min = center - half;
+        box.max = center + half;
+    }
+
+    QElapsedTimer buildTimer;
+    buildTimer.start();
+    Bvh tree;
+    tree.build(boxes);
+    double buildMs = buildTimer.nsecsElapsed() / 1000000.0;
+
+    int mismatches = 0;
+    int hits = 0;
+
+    // 任意方向的射线，同时计时
+    std::vector<QVector3D> origins(RAY_COUNT);
+    std::vector<QVector3D> directions(RAY_COUNT);
+    for (int i = 0; i < RAY_COUNT; i++) {
+        origins[i] = randomPoint(random, RANGE * 1.2f);
+        directions[i] = randomDirection(random);
+    }
+    std::vector<RayHit> results(RAY_COUNT);
+    std::vector<char> found(RAY_COUNT);
+    QElapsedTimer queryTimer;
+    queryTimer.start();
+    for (int i = 0; i < RAY_COUNT; i++) {
+        found[i] = tree.raycast(origins[i], directions[i], MAX_DISTANCE, results[i]);
+    }
+    double queryUs = queryTimer.nsecsElapsed() / 1000.0 / RAY_COUNT;
+    QElapsedTimer bruteTimer;
+    bruteTimer.start();
+    for (int i = 0; i < RAY_COUNT; i++) {
+        double t = 0.0;
+        bool expected = referenceNearest(boxes, origins[i], directions[i], QVector3D(), MAX_DISTANCE, t);
+        hits += expected;
+        if (!sameNearest(found[i], results[i], expected, t)) {
+            mismatches++;
+        }
+    }
+    double bruteUs = bruteTimer.nsecsElapsed() / 1000.0 / RAY_COUNT;
+
+    // 轴向射线：另外两个分量为 0，起点落在某个包围盒的 slab 平面上
+    int axisMismatches = 0;
+    for (int i = 0; i < AXIS_RAY_COUNT; i++) {
+        const AABB& box = boxes[random.bounded(0, BOX_COUNT)];
+        int axis = random.bounded(0, 3);
+        QVector3D origin;
+        QVector3D direction;
+        for (int a = 0; a < 3; a++) {
+            if (a == axis) {
+                direction[a] = (i & 1) ? 1.0f : -1.0f;
+                origin[a] = (i & 1) ? -RANGE * 1.2f : RANGE * 1.2f;
+            } else {
+                origin[a] = ((i >> 1) & 1) ? box.min[a] : box.max[a];
+            }
+        }
+        RayHit result;
+        bool hit = tree.raycast(origin, direction, MAX_DISTANCE, result);
+        double t = 0.0;
+        bool expected = referenceNearest(boxes, origin, direction, QVector3D(), MAX_DISTANCE, t);
+        if (!expected || !sameNearest(hit, result, expected, t)) {
+            axisMismatches++;
+        }
+    }
+
+    // 扫掠：随机尺寸的包围盒沿随机线段移动，一半只沿一个轴
+    int sweepMismatches = 0;
+    for (int i = 0; i < SWEEP_COUNT; i++) {
+        QVector3D center = randomPoint(random, RANGE);
+        QVector3D half(randomFloat(random, 0.1f, 0.5f), randomFloat(random, 0.1f, 0.5f), randomFloat(random, 0.1f, 0.5f));
+        AABB moving;
+        moving.min = center - half;
+        moving.max = center + half;
+        QVector3D delta = randomDirection(random) * randomFloat(random, 1.0f, 20.0f);
+        if (i & 1) {
+            int axis = random.bounded(0, 3);
+            for (int a = 0; a < 3; a++) {
+                if (a != axis) {
+                    delta[a] = 0.0f;
+                }
+            }
+        }
+        RayHit result;
+        bool hit = tree.sweep(moving, delta, result);
+        double t = 0.0;
+        bool expected = referenceNearest(boxes, center, delta, half, 1.0, t);
+        if (!sameNearest(hit, result, expected, t)) {
+            sweepMismatches++;
+        }
+    }
+
+    // 全部命中：个数与暴力求交一致，且按距离排序
+    int allMismatches = 0;
+    std::vector<RayHit> all;
+    for (int i = 0; i < ALL_HITS_COUNT; i++) {
+        tree.raycastAll(origins[i], directions[i], MAX_DISTANCE, all);
+        bool sorted = std::is_sorted(all.begin(), all.end(), [](const RayHit& a, const RayHit& b) {
+            return a.t < b.t;
+        });
+        if (!sorted || int(all.size()) != referenceCount(boxes, origins[i], directions[i], MAX_DISTANCE)) {
+            allMismatches++;
+        }
+    }
+
+    // 重新拟合：每个包围盒移动约一帧的位移，更新后射线仍须与暴力求交一致
+    for (AABB& box : boxes) {
+        QVector3D offset = randomPoint(random, 0.1f);
+        box.min += offset;
+        box.max += offset;
+    }
+    QElapsedTimer updateTimer;
+    updateTimer.start();
+    tree.update(boxes);
+    double updateMs = updateTimer.nsecsElapsed() / 1000000.0;
+    int refitMismatches = 0;
+    for (int i = 0; i < REFIT_RAY_COUNT; i++) {
+        RayHit result;
+        bool hit = tree.raycast(origins[i], directions[i], MAX_DISTANCE, result);
+        double t = 0.0;
+        bool expected = referenceNearest(boxes, origins[i], directions[i], QVector3D(), MAX_DISTANCE, t);
+        if (!sameNearest(hit, result, expected, t)) {
+            refitMismatches++;
+        }
+    }
+
+    qDebug().noquote() << QString("bvh selftest: %1 boxes built in %2 ms; nearest hit %3 us/query (brute force %4 us), %5/%6 rays hit")
+                              .arg(BOX_COUNT)
+                              .arg(buildMs, 0, 'f', 1)
+                              .arg(queryUs, 0, 'f', 2)
+                              .arg(bruteUs, 0, 'f', 1)
+                              .arg(hits)
+                              .arg(RAY_COUNT);
+    qDebug().noquote() << QString("bvh selftest: refit after moving every box in %1 ms").arg(updateMs, 0, 'f', 2);
+    qDebug().noquote() << QString("bvh selftest: mismatches: rays %1/%2, axis-aligned rays on slab planes %3/%4, sweeps %5/%6, all hits %7/%8, "
+                                  "rays after refit %9/%10")
+                              .arg(mismatches)
+                              .arg(RAY_COUNT)
+                              .arg(axisMismatches)
+                              .arg(AXIS_RAY_COUNT)
+                              .arg(sweepMismatches)
+                              .arg(SWEEP_COUNT)
+                              .arg(allMismatches)
+                              .arg(ALL_HITS_COUNT)
+                              .arg(refitMismatches)
+                              .arg(REFIT_RAY_COUNT);
+    return mismatches + axisMismatches + sweepMismatches + allMismatches + refitMismatches == 0 ? 0 : 1;
+}
+
+int SelfTest::particles() {
+    const int STEPS = 600;
+    const float DELTA_TIME = 1.0f / 60.0f;
+
+    QSurfaceFormat format = QSurfaceFormat::defaultFormat();
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    QOpenGLContext context;
+    context.setFormat(format);
+    QOffscreenSurface surface;
+    surface.setFormat(format);
+    surface.create();
+    GLFunctions gl;
+    if (!context.create() || !context.makeCurrent(&surface) || !gl.initializeOpenGLFunctions()) {
+        qDebug() << "Particle self-test needs an OpenGL 3.3 core context!";
+        return 1;
+    }
+    qDebug().noquote() << QString("particle selftest: %1").arg(reinterpret_cast<const char*>(gl.glGetString(GL_RENDERER)));
+
+    // 光栅化虽被丢弃，绘制仍要求完整的帧缓冲；无表面的离屏上下文没有默认帧缓冲，绑定一个 1x1 的
+    GLRenderbuffer color;
+    color.create(&gl);
+    gl.glBindRenderbuffer(GL_RENDERBUFFER, color);
+    gl.glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 1, 1);
+    gl.glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    GLFramebuffer fbo;
+    fbo.create(&gl);
+    gl.glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    gl.glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+
+    ParticleConfig config;
+    config.count = 10000;
+    AABB bounds;
+    bounds.min = QVector3D(-5.0f, -5.0f, -5.0f);
+    bounds.max = QVector3D(5.0f, 5.0f, 5.0f);
+
+    ParticleSystem gpuParticles;
+    config.gpu = true;
+    gpuParticles.init(&gl, config, bounds, 4);
+    ParticleSystem cpuParticles;
+    config.gpu = false;
+    cpuParticles.init(&gl, config, bounds, 4);
+
+    // 变换反馈从 buffer(current()) 读取，两个缓冲各一个状态 VAO
+    GeometryPool pool;
+    pool.init(&gl);
+    VertexArrays arrays;
+    arrays.init(&gl, pool);
+    GLuint sources[2] = { arrays.addStateArray(gpuParticles.buffer(0), 2), arrays.addStateArray(gpuParticles.buffer(1), 2) };
+
+    double gpuMs = 0.0;
+    double cpuMs = 0.0;
+    QElapsedTimer timer;
+    for (int step = 0; step < STEPS; step++) {
+        timer.start();
+        gpuParticles.update(&gl, sources[gpuParticles.current()], DELTA_TIME, bounds);
+        gl.glFinish();
+        gpuMs += timer.nsecsElapsed() / 1000000.0;
+        timer.start();
+        cpuParticles.update(&gl, 0, DELTA_TIME, bounds);
+        cpuMs += timer.nsecsElapsed() / 1000000.0;
+    }
+
+    size_t floats = size_t(config.count) * ParticleSystem::FLOATS_PER_PARTICLE;
+    std::vector<float> gpuState(floats);
+    std::vector<float> cpuState(floats);
+    gl.glBindBuffer(GL_ARRAY_BUFFER, gpuParticles.buffer(gpuParticles.current()));
+    gl.glGetBufferSubData(GL_ARRAY_BUFFER, 0, GLsizeiptr(floats * sizeof(float)), gpuState.data());
+    gl.glBindBuffer(GL_ARRAY_BUFFER, cpuParticles.buffer(cpuParticles.current()));
+    gl.glGetBufferSubData(GL_ARRAY_BUFFER, 0, GLsizeiptr(floats * sizeof(float)), cpuState.data());
+    gl.glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // 逐位比较；不同实现可能融合乘加，另报最大误差，不超过 1e-3 视为通过
+    int differing = 0;
+    double maxError = 0.0;
+    for (size_t i = 0; i < floats; i++) {
+        if (std::memcmp(&gpuState[i], &cpuState[i], sizeof(float)) != 0) {
+            differing++;
+        }
+        maxError = std::max(maxError, double(std::abs(gpuState[i] - cpuState[i])));
+    }
+    qDebug().noquote() << QString("particle selftest: %1 particles x %2 steps, gpu %3 ms/step, cpu %4 ms/step; "
+                                  "%5 of %6 floats differ, max error %7")
+                              .arg(config.count)
+                              .arg(STEPS)
+                              .arg(gpuMs / STEPS, 0, 'f', 3)
+                              .arg(cpuMs / STEPS, 0, 'f', 3)
+                              .arg(differing)
+                              .arg(qint64(floats))
+                              .arg(maxError, 0, 'g', 3);
+
+    arrays.destroy();
+    gpuParticles.destroy();
+    cpuParticles.destroy();
+    gl.glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    fbo.reset();
+    color.reset();
+    context.doneCurrent();
+    return maxError <= 1e-3 ? 0 : 1;
+}
@@ -0,0 +1,18 @@
+#ifndef SELFTEST_H
+#define SELFTEST_H
+
+
+// 命令行 --selftest 选择的自检：不打开窗口，结果写入调试输出，返回值作为进程退出码（0 为通过）
+namespace SelfTest {
+
+// BVH 的最近命中、全部命中与扫掠和逐个包围盒的暴力求交比较，含起点恰在 slab 平面上的轴向射线，并输出单次查询耗时
+int bvh();
+
+// 同一组粒子分别用变换反馈和 CPU 积分推进若干步后回读比较，在离屏上下文中运行，
+// 没有 GPU 时可用 Mesa llvmpipe（LIBGL_ALWAYS_SOFTWARE=1）
+int particles();
+
+}
+
+
+#endif // SELFTEST_H
@@ -0,0 +1,123 @@
+#include "ShaderLibrary.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <iterator>
+#include "FramePipeline.h"
+
+namespace {
+
+// 特性位与宏名，按位序展开，同一组特性总是得到相同的宏
+const char* const featureNames[] = {
+    "TEXTURED",
+    "COLORED",
+    "TEXTURE_ARRAY",
+    "INSTANCED",
+    "FILTER_INVERT",
+    "FILTER_GRAY"
+};
+
+// 链接后设置的采样器纹理单元，未列出的保持默认的 0 号单元
+const struct {
+    const char* name;
+    int unit;
+} samplerUnits[] = {
+    { "texture1", 0 },
+    { "texture2", 1 }
+};
+
+}
+
+void ShaderLibrary::destroy() {
+    for (int i = 0; i < programs.size(); i++) {
+        GLResourceRegistry::destroyed(GLObjectType::Program, 0);
+    }
+    qDeleteAll(programs);
+    programs.clear();
+    pending.clear();
+}
+
+ShaderProgram& ShaderLibrary::program(GLFunctions* functions, const ShaderVariant& variant, FrameStats& stats) {
+    ShaderProgram* found = programs.value(variant, nullptr);
+    if (found) {
+        return *found;
+    }
+    QElapsedTimer compileTimer;
+    compileTimer.start();
+    ShaderProgram* compiled = compile(functions, variant);
+    programs.insert(variant, compiled);
+    stats.shaderCompiles++;
+    stats.shaderCompileMsSum += compileTimer.nsecsElapsed() / 1000000.0;
+    return *compiled;
+}
+
+void ShaderLibrary::prewarm(const ShaderVariant& variant) {
+    pending.push_back(variant);
+}
+
+void ShaderLibrary::warmUp(GLFunctions* functions, FrameStats& stats) {
+    // 已被绘制用到的变体直接跳过，每次最多真正编译一个，避免单帧卡顿
+    while (!pending.empty()) {
+        ShaderVariant variant = pending.front();
+        pending.pop_front();
+        if (!programs.contains(variant)) {
+            program(functions, variant, stats);
+            return;
+        }
+    }
+}
+
+ShaderProgram* ShaderLibrary::compile(GLFunctions* functions, const ShaderVariant& variant) {
+    QByteArray defines;
+    for (int bit = 0; bit < int(std::size(featureNames)); bit++) {
+        if (variant.features & (1u << bit)) {
+            defines += QByteArray("#define ") + featureNames[bit] + "\n";
+        }
+    }
+
+    ShaderProgram* shader = new ShaderProgram();
+    GLResourceRegistry::created(GLObjectType::Program);
+    bool success = shader->addShaderFromSourceCode(QOpenGLShader::Vertex, loadSource(variant.vertex, defines));
+    if (!success) {
+        qDebug() << "ShaderLibrary addShaderFromSourceCode failed!" << variant.vertex << defines << shader->log();
+        return shader;
+    }
+    success = shader->addShaderFromSourceCode(QOpenGLShader::Fragment, loadSource(variant.fragment, defines));
+    if (!success) {
+        qDebug() << "ShaderLibrary addShaderFromSourceCode failed!" << variant.fragment << defines << shader->log();
+        return shader;
+    }
+    success = shader->link();
+    if (!success) {
+        qDebug() << "ShaderLibrary link failed!" << variant.vertex << defines << shader->log();
+        return shader;
+    }
+
+    // 相机参数来自 FramePipeline 绑定的 Frame 块，后期着色器没有这个块
+    GLuint block = functions->glGetUniformBlockIndex(shader->programId(), "Frame");
+    if (block != GL_INVALID_INDEX) {
+        functions->glUniformBlockBinding(shader->programId(), block, FramePipeline::UNIFORM_BINDING);
+    }
+    shader->bind();
+    for (const auto& sampler : samplerUnits) {
+        GLint location = shader->uniformLocation(sampler.name);
+        if (location >= 0) {
+            functions->glUniform1i(location, sampler.unit);
+        }
+    }
+    shader->release();
+    shader->modelLocation = shader->uniformLocation("model");
+    return shader;
+}
+
+QByteArray ShaderLibrary::loadSource(const char* path, const QByteArray& defines) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qDebug() << "Failed to open shader file!" << path;
+        return QByteArray();
+    }
+    QByteArray source = file.readAll();
+    // #version 必须是第一行，宏插在其后；#line 让编译日志的行号与源文件一致
+    int firstLine = source.indexOf('\n') + 1;
+    return source.left(firstLine) + defines + "#line 2\n" + source.mid(firstLine);
+}
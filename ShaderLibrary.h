@@ -0,0 +1,68 @@
+#ifndef SHADERLIBRARY_H
+#define SHADERLIBRARY_H
+
+
+#include <QByteArrayView>
+#include <QHash>
+#include <QOpenGLShaderProgram>
+#include <deque>
+#include "FrameStats.h"
+#include "GLFunctions.h"
+#include "GLResource.h"
+
+// 着色器变体：一对源文件加一组特性位，特性位展开为 #version 之后的同名宏
+struct ShaderVariant {
+    const char* vertex = nullptr;
+    const char* fragment = nullptr;
+    unsigned features = 0;
+
+    bool operator==(const ShaderVariant& other) const {
+        return features == other.features && qstrcmp(vertex, other.vertex) == 0 && qstrcmp(fragment, other.fragment) == 0;
+    }
+};
+
+inline size_t qHash(const ShaderVariant& variant, size_t seed = 0) {
+    return qHashMulti(seed, QByteArrayView(variant.vertex), QByteArrayView(variant.fragment), variant.features);
+}
+
+// 编译好的变体；每个变体是独立的程序，常用 uniform 的位置在链接后解析一次，绘制循环中不再按名字查找
+class ShaderProgram : public QOpenGLShaderProgram {
+public:
+    GLint modelLocation = -1;   // 没有 model 时为 -1，glUniform* 会忽略
+};
+
+// 按需编译的着色器库：变体第一次被使用时才编译链接，同一组宏只编译一次
+// 程序对象可在同一共享组的任意上下文中使用，但只能在一个线程中调用
+class ShaderLibrary {
+public:
+    // 特性位
+    static constexpr unsigned TEXTURED = 1u << 0;
+    static constexpr unsigned COLORED = 1u << 1;
+    static constexpr unsigned TEXTURE_ARRAY = 1u << 2;
+    static constexpr unsigned INSTANCED = 1u << 3;
+    static constexpr unsigned FILTER_INVERT = 1u << 4;
+    static constexpr unsigned FILTER_GRAY = 1u << 5;
+
+    // 以下调用都需要共享组中的某个上下文为当前上下文，functions 属于该上下文
+    void destroy();
+
+    // 取得变体，未编译时在当前上下文中编译；失败的程序同样缓存，bind() 时返回 false
+    ShaderProgram& program(GLFunctions* functions, const ShaderVariant& variant, FrameStats& stats);
+
+    // 登记之后可能用到的变体（如按键才开启的通道），由 warmUp 在帧间逐个编译
+    void prewarm(const ShaderVariant& variant);
+    // 编译一个尚未使用过的待预热变体，没有剩余时不做任何事
+    void warmUp(GLFunctions* functions, FrameStats& stats);
+
+    int compiledCount() const { return int(programs.size()); }
+
+private:
+    ShaderProgram* compile(GLFunctions* functions, const ShaderVariant& variant);
+    static QByteArray loadSource(const char* path, const QByteArray& defines);
+
+    QHash<ShaderVariant, ShaderProgram*> programs;
+    std::deque<ShaderVariant> pending;
+};
+
+
+#endif // SHADERLIBRARY_H
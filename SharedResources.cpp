@@ -0,0 +1,304 @@
+#include "SharedResources.h"
+#include "MeshLibrary.h"
+#include <QDebug>
+#include <QImage>
+
+namespace {
+
+// 缩小后求平均，作为代理网格的烘焙颜色
+// 平滑缩放的结果是预乘的 ARGB32（小端按 B,G,R,A 存放），需转回 RGBA8888 再按字节读取
+QVector3D averageColor(const QImage& image) {
+    QImage small = image.scaled(16, 16, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)
+                       .convertToFormat(QImage::Format_RGBA8888);
+    QVector3D sum;
+    for (int y = 0; y < small.height(); y++) {
+        const uchar* line = small.constScanLine(y);
+        for (int x = 0; x < small.width(); x++) {
+            sum += QVector3D(line[x * 4], line[x * 4 + 1], line[x * 4 + 2]);
+        }
+    }
+    return sum / (255.0f * small.width() * small.height());
+}
+
+}
+
+SharedResources* SharedResources::instance = nullptr;
+int SharedResources::references = 0;
+
+SharedResources* SharedResources::acquire(GLFunctions* functions, const Scene& scene) {
+    if (!instance) {
+        instance = new SharedResources(functions);
+        instance->setupTextures();
+        instance->setupBoxes(scene);
+        instance->setupVertices(scene);
+        instance->particles.init(functions, scene.particles, scene.boundaryAABB, int(scene.boxLayers.size()));
+        instance->streaming.init(functions, scene);
+        instance->setupShaders(scene);
+        instance->jobs.start(scene.workerThreads);
+        qDebug().noquote() << instance->geometry.report() + QString("\n  box instances %1 B, particle state %2 B")
+                                                                .arg(qint64(instance->boxCount) * VertexArrays::FLOATS_PER_INSTANCE * sizeof(float))
+                                                                .arg(qint64(instance->particles.count()) * ParticleSystem::FLOATS_PER_PARTICLE * sizeof(float) * 2);
+        // 确保其他上下文看到的是上传完成的资源
+        functions->glFlush();
+    }
+    references++;
+    return instance;
+}
+
+void SharedResources::release(GLFunctions* functions) {
+    if (!instance || --references > 0) {
+        return;
+    }
+    // 创建资源的视图可能已先销毁，改用最后一个视图的函数表删除
+    instance->gl = functions;
+    delete instance;
+    instance = nullptr;
+}
+
+SharedResources::SharedResources(GLFunctions* functions) : gl(functions) {
+}
+
+SharedResources::~SharedResources() {
+    // 纹理与实例缓冲的句柄随成员析构删除，此时共享组中仍有当前上下文
+    geometry.init(gl);
+    geometry.destroy();
+    particles.destroy();
+    streaming.destroy();
+    shaders.destroy();
+}
+
+ShaderVariant SharedResources::filterShader(Filter filter) {
+    ShaderVariant variant = { ":/shaders/filter.vert", ":/shaders/filter.frag", 0 };
+    if (filter == Filter::Invert) {
+        variant.features = ShaderLibrary::FILTER_INVERT;
+    } else if (filter == Filter::Gray) {
+        variant.features = ShaderLibrary::FILTER_GRAY;
+    }
+    return variant;
+}
+
+void SharedResources::setupShaders(const Scene& scene) {
+    // 启动时不编译任何着色器，第一帧按需编译用到的变体；
+    // 按键才开启的深度预通道与遮挡查询所用的变体登记为预热，之后在帧间逐个编译
+    if (!scene.prewarmShaders) {
+        return;
+    }
+    shaders.prewarm(sceneShader(ShaderLibrary::COLORED));
+    shaders.prewarm(sceneShader(ShaderLibrary::TEXTURED));
+    shaders.prewarm(skyboxShader());
+    shaders.prewarm(sceneShader(0));
+    if (boxCount > 0 || particles.count() > 0 || streaming.enabled()) {
+        shaders.prewarm(sceneShader(ShaderLibrary::TEXTURE_ARRAY | ShaderLibrary::INSTANCED));
+    }
+    if (scene.filter != Filter::None) {
+        shaders.prewarm(filterShader(scene.filter));
+    }
+}
+
+void SharedResources::setupTextures() {
+    // 加载天空盒纹理
+    std::vector<std::string> faces
+    {
+        ":/res/skybox/right.jpg",
+        ":/res/skybox/left.jpg",
+        ":/res/skybox/top.jpg",
+        ":/res/skybox/bottom.jpg",
+        ":/res/skybox/front.jpg",
+        ":/res/skybox/back.jpg"
+    };
+    skyboxTexture = loadCubemap(faces);
+
+    // 加载盒子纹理
+    // texture 1
+    // ---------
+    texture1.create(gl);
+    gl->glBindTexture(GL_TEXTURE_2D, texture1);
+    // set the texture wrapping parameters
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);   // set texture wrapping to GL_REPEAT (default wrapping method)
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    // set texture filtering parameters
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // load image, create texture and generate mipmaps
+    QImage img1 = QImage(":/res/cube/container.jpg").convertToFormat(QImage::Format_RGB888);
+    if (!img1.isNull()) {
+        gl->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, img1.width(), img1.height(), 0, GL_RGB, GL_UNSIGNED_BYTE, img1.bits());
+        gl->glGenerateMipmap(GL_TEXTURE_2D);
+        texture1.setBytes(GLResourceRegistry::imageBytes(img1.width(), img1.height(), 1, true));
+    }
+
+    // texture 2
+    // ---------
+    texture2.create(gl);
+    gl->glBindTexture(GL_TEXTURE_2D, texture2);
+    // set the texture wrapping parameters
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);   // set texture wrapping to GL_REPEAT (default wrapping method)
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    // set texture filtering parameters
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // load image, create texture and generate mipmaps
+    QImage img2 = QImage(":/res/cube/awesomeface.png").convertToFormat(QImage::Format_RGBA8888).mirrored(true, true);
+    if (!img2.isNull()) {
+        // note that the awesomeface.png has transparency and thus an alpha channel, so make sure to tell OpenGL the data type is of GL_RGBA
+        gl->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, img2.width(), img2.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, img2.bits());
+        gl->glGenerateMipmap(GL_TEXTURE_2D);
+        texture2.setBytes(GLResourceRegistry::imageBytes(img2.width(), img2.height(), 1, true));
+    }
+}
+
+GLTexture SharedResources::loadCubemap(std::vector<std::string> faces) {
+    GLTexture texture;
+    texture.create(gl);
+    gl->glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    qint64 bytes = 0;
+
+    int width, height, nrChannels;
+    for (unsigned int i = 0; i < faces.size(); i++)
+    {
+        QImage img = QImage(faces[i].c_str()).convertToFormat(QImage::Format_RGB888);
+        if (!img.isNull())
+        {
+            gl->glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, img.width(), img.height(), 0, GL_RGB, GL_UNSIGNED_BYTE, img.bits());
+            bytes += GLResourceRegistry::imageBytes(img.width(), img.height());
+        }
+        else
+        {
+            qDebug() << "Cubemap texture failed to load at path: " << faces[i].c_str();
+        }
+    }
+
+    gl->glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    gl->glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    gl->glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    gl->glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    gl->glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    texture.setBytes(bytes);
+    return texture;
+}
+
+void SharedResources::setupVertices(const Scene& scene) {
+    geometry.init(gl);
+    meshReport.clear();
+
+    // 固定网格在编译期生成
+    skyboxMesh = addMesh(MeshLibrary::SKYBOX.toMeshData(), "skybox");
+    cubeMesh = addMesh(MeshLibrary::TEXTURED_CUBE.toMeshData(), "cube");
+    quadMesh = addMesh(MeshLibrary::QUAD.toMeshData(), "quad");
+
+    // 设置立方体1、2
+    cube1Mesh = setupCube(scene.cube1Position, scene.cube1Rotation, scene.cube1Size, scene.cube1Color);
+    cube2Mesh = setupCube(scene.cube2Position, scene.cube2Rotation, scene.cube2Size, scene.cube2Color);
+
+    // 动态物体可选的其他形状
+    sphereMesh = addMesh(MeshLibrary::sphere(32, 16), "sphere");
+    cylinderMesh = addMesh(MeshLibrary::cylinder(32), "cylinder");
+
+    setupProxies(scene);
+
+    // 所有网格按格式合并，一次性上传
+    geometry.upload();
+    qDebug().noquote() << meshReport;
+}
+
+MeshRange SharedResources::addMesh(MeshData mesh, const QString& name) {
+    meshReport += (meshReport.isEmpty() ? QString("meshes:\n  ") : QString("\n  ")) + MeshLibrary::optimize(mesh, name);
+    return geometry.add(mesh.format, mesh.vertices.data(), mesh.vertexCount(), mesh.indices.data(), int(mesh.indices.size()));
+}
+
+MeshRange SharedResources::setupCube(const QVector3D& position, const QVector3D& rotation, float size, QVector3D color) {
+    // 静态立方体的模型变换直接烘焙进顶点，使同格式的立方体能用一次调用绘制
+    QMatrix4x4 model;
+    model.translate(position);
+    model.rotate(rotation.x(), QVector3D(1.0f, 0.0f, 0.0f));
+    model.rotate(rotation.y(), QVector3D(0.0f, 1.0f, 0.0f));
+    model.rotate(rotation.z(), QVector3D(0.0f, 0.0f, 1.0f));
+
+    MeshData mesh = MeshLibrary::box(size, color);
+    for (int i = 0; i < mesh.vertexCount(); i++) {
+        float* vertex = &mesh.vertices[i * 6];
+        QVector3D p = model.map(QVector3D(vertex[0], vertex[1], vertex[2]));
+        vertex[0] = p.x();
+        vertex[1] = p.y();
+        vertex[2] = p.z();
+    }
+    return addMesh(mesh, "static cube");
+}
+
+void SharedResources::setupBoxes(const Scene& scene) {
+    // 流式加载的块同样使用纹理数组，没有逐个列出的盒子时实例缓冲为空
+    if (scene.boxLayers.empty() || (scene.boxes.empty() && !scene.streaming.enabled)) {
+        return;
+    }
+
+    // 所有层统一缩放到同一尺寸后存入一个 GL_TEXTURE_2D_ARRAY，绘制时只需绑定一次
+    const int layerSize = 512;
+    int layerCount = int(scene.boxLayers.size());
+    layerColors.assign(layerCount, QVector3D(0.5f, 0.5f, 0.5f));
+    textureArray.create(gl);
+    gl->glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray);
+    gl->glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, layerSize, layerSize, layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    textureArray.setBytes(GLResourceRegistry::imageBytes(layerSize, layerSize, layerCount, true));
+    for (int i = 0; i < layerCount; i++) {
+        QImage img = QImage(scene.boxLayers[i]).convertToFormat(QImage::Format_RGBA8888);
+        if (img.isNull()) {
+            qDebug() << "Texture array layer failed to load at path: " << scene.boxLayers[i];
+            continue;
+        }
+        img = img.scaled(layerSize, layerSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        layerColors[i] = averageColor(img);
+        gl->glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, layerSize, layerSize, 1, GL_RGBA, GL_UNSIGNED_BYTE, img.constBits());
+    }
+    gl->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    gl->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    gl->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    gl->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    gl->glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    gl->glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // 开启代理时按簇排列，同一簇的盒子在实例缓冲中连续
+    boxOrder.clear();
+    if (scene.proxies.enabled) {
+        proxies.build(scene.boxes, scene.proxies, boxOrder);
+    } else {
+        for (int i = 0; i < int(scene.boxes.size()); i++) {
+            boxOrder.push_back(i);
+        }
+    }
+
+    // 逐实例数据：位置、边长、纹理层
+    std::vector<float> instances;
+    instances.reserve(scene.boxes.size() * VertexArrays::FLOATS_PER_INSTANCE);
+    for (int index : boxOrder) {
+        const BoxInstance& box = scene.boxes[index];
+        instances.push_back(box.position.x());
+        instances.push_back(box.position.y());
+        instances.push_back(box.position.z());
+        instances.push_back(box.size);
+        instances.push_back(float(box.layer));
+    }
+    boxInstanceBuffer.create(gl);
+    gl->glBindBuffer(GL_ARRAY_BUFFER, boxInstanceBuffer);
+    gl->glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(float), instances.data(), GL_STATIC_DRAW);
+    boxInstanceBuffer.setBytes(qint64(instances.size() * sizeof(float)));
+    gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
+    boxCount = int(scene.boxes.size());
+}
+
+void SharedResources::setupProxies(const Scene& scene) {
+    if (proxies.isEmpty()) {
+        return;
+    }
+    int proxyBoxes = 0;
+    for (int i = 0; i < int(proxies.nodes.size()); i++) {
+        MeshData mesh = proxies.proxyMesh(i, scene.boxes, boxOrder, layerColors);
+        proxyBoxes += mesh.vertexCount() / 8;
+        proxies.nodes[i].proxy = geometry.add(mesh.format, mesh.vertices.data(), mesh.vertexCount(), mesh.indices.data(), int(mesh.indices.size()));
+    }
+    meshReport += QString("\n  proxies: %1 boxes in %2 clusters (%3 top level), %4 merged boxes")
+                      .arg(scene.boxes.size())
+                      .arg(proxies.nodes.size())
+                      .arg(proxies.rootCount)
+                      .arg(proxyBoxes);
+}
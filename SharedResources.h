@@ -0,0 +1,86 @@
+#ifndef SHAREDRESOURCES_H
+#define SHAREDRESOURCES_H
+
+
+#include <string>
+#include <vector>
+#include "FramePipeline.h"
+#include "GeometryPool.h"
+#include "GLFunctions.h"
+#include "ChunkStreamer.h"
+#include "GLResource.h"
+#include "JobSystem.h"
+#include "MeshLibrary.h"
+#include "ParticleSystem.h"
+#include "ProxyHierarchy.h"
+#include "Scene.h"
+#include "ShaderLibrary.h"
+
+// 所有视图共用的 GL 资源：着色器、纹理和几何缓冲只创建一份
+// 各视图的上下文需在同一共享组中（Qt::AA_ShareOpenGLContexts），VAO 与帧缓冲不可共享，仍归各视图所有
+class SharedResources {
+public:
+    // 第一个视图创建资源，最后一个视图释放时销毁；调用时需有当前上下文
+    static SharedResources* acquire(GLFunctions* functions, const Scene& scene);
+    static void release(GLFunctions* functions);
+    static int refCount() { return references; }
+
+    // 场景用到的着色器变体，由 shaders 在第一次绘制时编译
+    static ShaderVariant sceneShader(unsigned features) { return { ":/shaders/scene.vert", ":/shaders/scene.frag", features }; }
+    static ShaderVariant skyboxShader() { return { ":/shaders/skybox.vert", ":/shaders/skybox.frag", 0 }; }
+    static ShaderVariant filterShader(Filter filter);
+
+    ShaderLibrary shaders;
+    // 准备绘制列表的工作线程，与共享资源同生命周期，各视图依次使用
+    JobSystem jobs;
+
+    GeometryPool geometry;
+    MeshRange quadMesh;
+    MeshRange skyboxMesh;
+    MeshRange cubeMesh;
+    MeshRange cube1Mesh;
+    MeshRange cube2Mesh;
+    MeshRange sphereMesh;
+    MeshRange cylinderMesh;
+
+    GLTexture skyboxTexture;
+    GLTexture texture1, texture2;
+
+    // 纹理数组盒子：每层一张图，逐实例的位置、边长和层号
+    GLTexture textureArray;
+    GLBuffer boxInstanceBuffer;
+    int boxCount = 0;
+    // 开启代理时实例数据按簇排列，每个簇有合并后的代理网格
+    ProxyHierarchy proxies;
+
+    ParticleSystem particles;
+    // 流式加载的网格盒子，未开启时 enabled() 为 false
+    ChunkStreamer streaming;
+
+private:
+    explicit SharedResources(GLFunctions* functions);
+    ~SharedResources();
+
+    void setupShaders(const Scene& scene);
+    void setupTextures();
+    void setupVertices(const Scene& scene);
+    void setupBoxes(const Scene& scene);
+    // 优化顶点缓存与取顶点顺序后加入几何池，ACMR 记入 meshReport
+    MeshRange addMesh(MeshData mesh, const QString& name);
+    MeshRange setupCube(const QVector3D& position, const QVector3D& rotation, float size, QVector3D color);
+    GLTexture loadCubemap(std::vector<std::string> faces);
+
+    // 代理网格需在几何池上传前加入，用到盒子的排列顺序和各纹理层的平均色
+    void setupProxies(const Scene& scene);
+
+    GLFunctions* gl;
+    QString meshReport;
+    std::vector<int> boxOrder;
+    std::vector<QVector3D> layerColors;
+
+    static SharedResources* instance;
+    static int references;
+};
+
+
+#endif // SHAREDRESOURCES_H
@@ -0,0 +1,43 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+
+#include <atomic>
+
+// 单生产者单消费者的无锁三缓冲：生产者写 back 后发布，消费者取最新发布的一份
+// 两端各持有一个槽，中间槽通过原子交换传递，双方都不会等待对方
+template <typename T>
+class TripleBuffer {
+public:
+    // 生产者端
+    T& back() { return buffers[backIndex]; }
+    int backSlot() const { return backIndex; }
+    void publish() {
+        int previous = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel);
+        backIndex = previous & INDEX;
+    }
+
+    // 消费者端：有新发布的数据时换到 front，返回是否换过
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        int previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+        frontIndex = previous & INDEX;
+        return true;
+    }
+    T& front() { return buffers[frontIndex]; }
+    int frontSlot() const { return frontIndex; }
+
+private:
+    static const int INDEX = 3;
+    static const int FRESH = 4;     // 中间槽尚未被消费者取走
+
+    T buffers[3] = {};
+    std::atomic<int> middle{ 1 };
+    int backIndex = 0;
+    int frontIndex = 2;
+};
+
+
+#endif // TRIPLEBUFFER_H
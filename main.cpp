@@ -1,11 +1,108 @@
+#include "MetricsServer.h"
 #include "QtOpenGLDemo.h"
+#include "RenderServer.h"
+#include "SelfTest.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QSurfaceFormat>
+#include <algorithm>
 
 int main(int argc, char *argv[])
 {
+    // 多视口的上下文需在同一共享组中才能共用着色器、纹理和缓冲
+    QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
+#ifdef GL_TRACE
+    // KHR_debug 的消息只在调试上下文中可靠产生
+    QSurfaceFormat format = QSurfaceFormat::defaultFormat();
+    format.setOption(QSurfaceFormat::DebugContext);
+    QSurfaceFormat::setDefaultFormat(format);
+#endif
     QApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption recordOption("record", "Record input and timesteps to <file>.", "file");
+    QCommandLineOption replayOption("replay", "Replay a recording frame-exactly, then quit.", "file");
+    QCommandLineOption baselineOption("baseline", "Compare replay frame times against <file>.", "file");
+    QCommandLineOption timingsOption("save-timings", "Save replay frame times to <file>.", "file");
+    QCommandLineOption captureOption("capture", "Capture every frame into <dir> asynchronously.", "dir");
+    QCommandLineOption captureFormatOption("capture-format", "Capture format: png or raw.", "format", "png");
+    QCommandLineOption captureSourceOption("capture-source", "Capture source: final or scene (before the filter).", "source", "final");
+    QCommandLineOption viewsOption("views", "Show <n> views of the same scene (1-16).", "n", "1");
+    QCommandLineOption renderThreadOption("render-thread", "Render on a dedicated thread; the view only composites finished frames.");
+    QCommandLineOption serveOption("serve", "Run headless, serving render requests on local socket <name>.", "name");
+    QCommandLineOption metricsOption("metrics", "Serve Prometheus metrics on http://127.0.0.1:<port>/metrics.", "port");
+    QCommandLineOption metricsJsonOption("metrics-json", "Write a JSON metrics snapshot to <file> every second.", "file");
+    QCommandLineOption selfTestOption("selftest", "Run a self-test (bvh or particles) and exit with its result.", "name");
+    parser.addOption(recordOption);
+    parser.addOption(replayOption);
+    parser.addOption(baselineOption);
+    parser.addOption(timingsOption);
+    parser.addOption(captureOption);
+    parser.addOption(captureFormatOption);
+    parser.addOption(captureSourceOption);
+    parser.addOption(viewsOption);
+    parser.addOption(renderThreadOption);
+    parser.addOption(serveOption);
+    parser.addOption(metricsOption);
+    parser.addOption(metricsJsonOption);
+    parser.addOption(selfTestOption);
+    parser.process(a);
+
+    if (parser.isSet(selfTestOption)) {
+        QString name = parser.value(selfTestOption);
+        if (name == "bvh") {
+            return SelfTest::bvh();
+        }
+        if (name == "particles") {
+            return SelfTest::particles();
+        }
+        qDebug() << "Unknown self-test!" << name;
+        return 1;
+    }
+
+    // 各种运行方式下都可导出指标
+    MetricsServer metrics;
+    if (parser.isSet(metricsOption)) {
+        bool ok = false;
+        uint port = parser.value(metricsOption).toUInt(&ok);
+        if (!ok || port == 0 || port > 65535) {
+            qDebug() << "Invalid metrics port!" << parser.value(metricsOption);
+            return 1;
+        }
+        if (!metrics.listen(quint16(port))) {
+            return 1;
+        }
+    }
+    if (parser.isSet(metricsJsonOption)) {
+        metrics.startDump(parser.value(metricsJsonOption));
+    }
+
+    if (parser.isSet(serveOption)) {
+        RenderServer server;
+        if (!server.start(parser.value(serveOption))) {
+            return 1;
+        }
+        return a.exec();
+    }
+
     QtOpenGLDemo w;
+    w.setViewCount(std::clamp(parser.value(viewsOption).toInt(), 1, 16));
+    if (parser.isSet(replayOption)) {
+        w.glWidget()->startReplay(parser.value(replayOption), parser.value(baselineOption), parser.value(timingsOption));
+    } else if (parser.isSet(recordOption)) {
+        w.glWidget()->startRecording(parser.value(recordOption));
+    }
+    if (parser.isSet(captureOption)) {
+        w.glWidget()->startCapture(parser.value(captureOption),
+                                   parser.value(captureFormatOption) == "raw" ? CaptureFormat::Raw : CaptureFormat::Png,
+                                   parser.value(captureSourceOption) == "scene");
+    }
+    if (parser.isSet(renderThreadOption)) {
+        w.glWidget()->setThreadedRendering(true);
+    }
     w.show();
     return a.exec();
 }
@@ -0,0 +1,19 @@
+#version 330 core
+// 后期滤镜，FILTER_INVERT 与 FILTER_GRAY 可同时定义，先反色再取灰度
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D screenTexture;
+
+void main()
+{
+    vec3 color = texture(screenTexture, TexCoords).rgb;
+#ifdef FILTER_INVERT
+    color = 1.0 - color;
+#endif
+#ifdef FILTER_GRAY
+    color = vec3(dot(color, vec3(0.2126, 0.7152, 0.0722)));
+#endif
+    FragColor = vec4(color, 1.0);
+}
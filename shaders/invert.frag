@@ -1,11 +0,0 @@
-#version 330 core
-out vec4 FragColor;
-
-in vec2 TexCoords;
-
-uniform sampler2D screenTexture;
-
-void main()
-{ 
-    FragColor = vec4(vec3(1.0 - texture(screenTexture, TexCoords)), 1.0);
-}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#version 330 core
+layout (location = 0) in vec4 aPosition;    // xyz: 位置, w: 边长
+layout (location = 1) in vec4 aVelocity;    // xyz: 速度, w: 纹理层
+
+uniform float deltaTime;
+uniform vec3 boundsMin;
+uniform vec3 boundsMax;
+
+out vec4 outPosition;
+out vec4 outVelocity;
+
+void main()
+{
+    vec3 halfSize = vec3(aPosition.w * 0.5);
+    vec3 low = boundsMin + halfSize;
+    vec3 high = boundsMax - halfSize;
+
+    vec3 position = aPosition.xyz + aVelocity.xyz * deltaTime;
+    vec3 velocity = aVelocity.xyz;
+
+    // 越过边界且仍向外运动的分量反向，位置夹回边界内
+    vec3 outside = step(position, low) * step(velocity, vec3(0.0)) + step(high, position) * step(vec3(0.0), velocity);
+    velocity = mix(velocity, -velocity, min(outside, vec3(1.0)));
+    position = clamp(position, low, high);
+
+    outPosition = vec4(position, aPosition.w);
+    outVelocity = vec4(velocity, aVelocity.w);
+}
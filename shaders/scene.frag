@@ -0,0 +1,28 @@
+#version 330 core
+#if defined(TEXTURED)
+out vec4 FragColor;
+in vec2 TexCoord;
+
+uniform sampler2D texture1;
+uniform sampler2D texture2;
+#elif defined(TEXTURE_ARRAY)
+out vec4 FragColor;
+in vec2 TexCoord;
+flat in float Layer;
+
+uniform sampler2DArray textures;
+#elif defined(COLORED)
+out vec4 FragColor;
+in vec3 ourColor;
+#endif
+
+void main()
+{
+#if defined(TEXTURED)
+    FragColor = mix(texture(texture1, TexCoord), texture(texture2, TexCoord), 0.2);
+#elif defined(TEXTURE_ARRAY)
+    FragColor = texture(textures, vec3(TexCoord, Layer));
+#elif defined(COLORED)
+    FragColor = vec4(ourColor, 1.0);
+#endif
+}
@@ -0,0 +1,49 @@
+#version 330 core
+// 场景物体共用的顶点着色器，特性宏由 ShaderLibrary 插入：
+// TEXTURED 双纹理混合，COLORED 顶点颜色，TEXTURE_ARRAY 纹理数组层，
+// INSTANCED 用逐实例的位置与边长代替 model；都未定义时只写深度
+layout (location = 0) in vec3 aPos;
+#ifdef COLORED
+layout (location = 1) in vec3 aColor;
+out vec3 ourColor;
+#endif
+#if defined(TEXTURED) || defined(TEXTURE_ARRAY)
+layout (location = 2) in vec2 aTexCoord;
+out vec2 TexCoord;
+#endif
+#ifdef INSTANCED
+layout (location = 3) in vec4 aInstance;    // xyz: 位置, w: 边长
+#else
+uniform mat4 model;
+#endif
+#ifdef TEXTURE_ARRAY
+layout (location = 4) in float aLayer;      // 纹理数组层
+flat out float Layer;
+#endif
+
+// 每帧的相机参数，由 FramePipeline 按帧写入各自的槽
+layout (std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+};
+
+// 深度预通道与颜色通道是不同的变体，位置须逐位一致
+invariant gl_Position;
+
+void main()
+{
+#ifdef INSTANCED
+    gl_Position = projection * view * vec4(aPos * aInstance.w + aInstance.xyz, 1.0);
+#else
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+#endif
+#ifdef COLORED
+    ourColor = aColor;
+#endif
+#if defined(TEXTURED) || defined(TEXTURE_ARRAY)
+    TexCoord = aTexCoord;
+#endif
+#ifdef TEXTURE_ARRAY
+    Layer = aLayer;
+#endif
+}
@@ -3,12 +3,15 @@ layout (location = 0) in vec3 aPos;
 
 out vec3 TexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
+layout (std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+};
 
 void main()
 {
     TexCoords = aPos;  
-    vec4 pos = projection * view * vec4(aPos, 1.0);
+    // 去掉平移，天空盒始终围绕相机
+    vec4 pos = projection * mat4(mat3(view)) * vec4(aPos, 1.0);
     gl_Position = pos.xyww; // 保持深度值为1.0
 }
\ No newline at end of file